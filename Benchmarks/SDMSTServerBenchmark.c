@@ -0,0 +1,185 @@
+/*
+ *  SDMSTServerBenchmark.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "SDMSTServer.h"
+#include "SDMSTClient.h"
+
+#define kBenchmarkSampleCapacity 0x100000
+#define kBenchmarkNamePool 0x400
+#define kBenchmarkBatchSize 0x100
+
+typedef struct BenchmarkWorker {
+	char *socketPath;
+	char *binaryPath;
+	bool batch;
+	double deadline;
+	uint64_t queries;
+	uint64_t failures;
+	double *samples;
+	uint64_t sampleCount;
+} BenchmarkWorker;
+
+double BenchmarkNow() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+int BenchmarkCompareSamples(const void *entry1, const void *entry2) {
+	double sample1 = *(const double *)entry1, sample2 = *(const double *)entry2;
+	return (sample1 < sample2 ? -1 : (sample1 > sample2 ? 1 : 0));
+}
+
+uint64_t BenchmarkRandom(uint64_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+void* BenchmarkWorkerRun(void *context) {
+	struct BenchmarkWorker *worker = (struct BenchmarkWorker *)context;
+	struct SDMSTClient *client = SDMSTClientConnect(worker->socketPath);
+	struct SDMSTClientTable table;
+	if (client == NULL || SDMSTClientRegister(client, worker->binaryPath, NULL, &table) != kSDMSTStatusOK || table.textSize == 0x0) {
+		worker->failures++;
+		SDMSTClientRelease(client);
+		return NULL;
+	}
+	uint64_t state = (uint64_t)(uintptr_t)worker | 0x1;
+	uint64_t *addresses = (uint64_t *)calloc(kBenchmarkBatchSize > kBenchmarkNamePool ? kBenchmarkBatchSize : kBenchmarkNamePool, sizeof(uint64_t));
+	struct SDMSTClientSymbol *symbols = (struct SDMSTClientSymbol *)calloc(kBenchmarkBatchSize > kBenchmarkNamePool ? kBenchmarkBatchSize : kBenchmarkNamePool, sizeof(struct SDMSTClientSymbol));
+	char **names = (char **)calloc(kBenchmarkNamePool, sizeof(char *));
+	uint32_t nameCount = 0x0;
+	for (uint32_t i = 0x0; i < kBenchmarkNamePool; i++)
+		addresses[i] = table.textAddress + BenchmarkRandom(&state) % table.textSize;
+	if (SDMSTClientSymbolizeAddresses(client, table.tableId, addresses, kBenchmarkNamePool, symbols) == kSDMSTStatusOK)
+		for (uint32_t i = 0x0; i < kBenchmarkNamePool; i++)
+			if (symbols[i].name)
+				names[nameCount++] = strndup(symbols[i].name, symbols[i].nameLength);
+	while (BenchmarkNow() < worker->deadline) {
+		uint16_t status = kSDMSTStatusOK;
+		double start = BenchmarkNow();
+		if (worker->batch) {
+			for (uint32_t i = 0x0; i < kBenchmarkBatchSize; i++)
+				addresses[i] = table.textAddress + BenchmarkRandom(&state) % table.textSize;
+			status = SDMSTClientSymbolizeAddresses(client, table.tableId, addresses, kBenchmarkBatchSize, symbols);
+		} else if (nameCount && (worker->queries & 0x1)) {
+			uint64_t address = 0x0;
+			status = SDMSTClientLookupName(client, table.tableId, names[BenchmarkRandom(&state) % nameCount], &address);
+		} else {
+			status = SDMSTClientLookupAddress(client, table.tableId, table.textAddress + BenchmarkRandom(&state) % table.textSize, &symbols[0x0]);
+		}
+		double elapsed = BenchmarkNow() - start;
+		if (status != kSDMSTStatusOK && status != kSDMSTStatusNotFound)
+			worker->failures++;
+		worker->samples[worker->sampleCount % kBenchmarkSampleCapacity] = elapsed;
+		worker->sampleCount++;
+		worker->queries += (worker->batch ? kBenchmarkBatchSize : 0x1);
+	}
+	for (uint32_t i = 0x0; i < nameCount; i++)
+		free(names[i]);
+	free(names);
+	free(symbols);
+	free(addresses);
+	SDMSTClientRelease(client);
+	return NULL;
+}
+
+void BenchmarkRun(char *socketPath, char *binaryPath, uint32_t threadCount, double seconds, bool batch) {
+	struct BenchmarkWorker *workers = (struct BenchmarkWorker *)calloc(threadCount, sizeof(struct BenchmarkWorker));
+	pthread_t *threads = (pthread_t *)calloc(threadCount, sizeof(pthread_t));
+	double start = BenchmarkNow();
+	for (uint32_t i = 0x0; i < threadCount; i++) {
+		workers[i] = (struct BenchmarkWorker){socketPath, binaryPath, batch, start + seconds * 1e9, 0x0, 0x0, (double *)calloc(kBenchmarkSampleCapacity, sizeof(double)), 0x0};
+		pthread_create(&threads[i], NULL, BenchmarkWorkerRun, &workers[i]);
+	}
+	uint64_t queries = 0x0, failures = 0x0, sampleCount = 0x0;
+	for (uint32_t i = 0x0; i < threadCount; i++) {
+		pthread_join(threads[i], NULL);
+		queries += workers[i].queries;
+		failures += workers[i].failures;
+		sampleCount += (workers[i].sampleCount < kBenchmarkSampleCapacity ? workers[i].sampleCount : kBenchmarkSampleCapacity);
+	}
+	double elapsed = (BenchmarkNow() - start) / 1e9;
+	double *samples = (double *)calloc(sampleCount + 0x1, sizeof(double));
+	uint64_t offset = 0x0;
+	for (uint32_t i = 0x0; i < threadCount; i++) {
+		uint64_t count = (workers[i].sampleCount < kBenchmarkSampleCapacity ? workers[i].sampleCount : kBenchmarkSampleCapacity);
+		memcpy(samples + offset, workers[i].samples, count * sizeof(double));
+		offset += count;
+		free(workers[i].samples);
+	}
+	qsort(samples, sampleCount, sizeof(double), BenchmarkCompareSamples);
+	double p50 = (sampleCount ? samples[sampleCount / 0x2] : 0.0) / 1e3;
+	double p99 = (sampleCount ? samples[(sampleCount * 99) / 100] : 0.0) / 1e3;
+	printf("%-7s %2i threads  %10.0f queries/s  p50 %8.2f us  p99 %8.2f us  failures %llu\n", (batch ? "batch" : "single"), threadCount, (double)queries / elapsed, p50, p99, (unsigned long long)failures);
+	free(samples);
+	free(threads);
+	free(workers);
+}
+
+void* BenchmarkServe(void *context) {
+	SDMSTServerRun((struct SDMSTServer *)context);
+	return NULL;
+}
+
+int main(int argc, const char * argv[]) {
+	if (argc < 3) {
+		printf("usage: %s <socket> <binary> [threads] [seconds]\n", argv[0]);
+		return 1;
+	}
+	char *socketPath = (char*)argv[1];
+	char *binaryPath = (char*)argv[2];
+	uint32_t threadCount = (argc >= 4 ? (uint32_t)atoi(argv[3]) : 0x4);
+	double seconds = (argc >= 5 ? atof(argv[4]) : 5.0);
+	struct SDMSTServer *server = NULL;
+	pthread_t serverThread;
+	struct SDMSTClient *probe = SDMSTClientConnect(socketPath);
+	if (probe == NULL) {
+		// Nothing is listening yet, so benchmark against an in-process instance on the same socket.
+		server = SDMSTServerCreate(socketPath);
+		pthread_create(&serverThread, NULL, BenchmarkServe, server);
+		for (uint32_t i = 0x0; i < 0x64 && probe == NULL; i++) {
+			usleep(0x2710);
+			probe = SDMSTClientConnect(socketPath);
+		}
+	}
+	struct SDMSTClientTable table;
+	double start = BenchmarkNow();
+	uint16_t status = (probe ? SDMSTClientRegister(probe, binaryPath, NULL, &table) : kSDMSTStatusTransportError);
+	if (status != kSDMSTStatusOK) {
+		printf("[%s] Unable to register: status %i\n", binaryPath, status);
+	} else {
+		printf("[%s] table %i, %i symbols, registered in %.2f ms\n", binaryPath, table.tableId, table.symbolCount, (BenchmarkNow() - start) / 1e6);
+		BenchmarkRun(socketPath, binaryPath, threadCount, seconds, false);
+		BenchmarkRun(socketPath, binaryPath, threadCount, seconds, true);
+	}
+	SDMSTClientRelease(probe);
+	if (server) {
+		SDMSTServerStop(server);
+		pthread_join(serverThread, NULL);
+		SDMSTServerRelease(server);
+	}
+	return (status == kSDMSTStatusOK ? 0 : 1);
+}
@@ -0,0 +1,99 @@
+/*
+ *  SDMSTStringBenchmark.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "SDMSymbolTable.h"
+#include "SDMSTString.h"
+
+#define kBenchmarkRounds 0x10
+#define kBenchmarkQueries 0x40
+
+static volatile uint64_t benchmarkSink;
+
+double BenchmarkNow() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+void BenchmarkVariant(const struct SDMSTStringKernels *kernels, char **names, char **copies, uint64_t *lengths, uint32_t count) {
+	uint64_t sink = 0x0, calls = 0x0;
+	double start = BenchmarkNow();
+	for (uint32_t round = 0x0; round < kBenchmarkRounds; round++)
+		for (uint32_t i = 0x0; i < count; i++)
+			sink += kernels->length(names[i]);
+	double lengthTime = (BenchmarkNow() - start) / ((double)kBenchmarkRounds * count);
+	
+	start = BenchmarkNow();
+	for (uint32_t round = 0x0; round < kBenchmarkRounds; round++) {
+		for (uint32_t i = 0x0; i < count; i++) {
+			sink += kernels->equal(names[i], copies[i], lengths[i]);
+			uint32_t next = (i + 0x1 < count ? i + 0x1 : 0x0);
+			sink += kernels->equal(names[i], names[next], (lengths[i] < lengths[next] ? lengths[i] : lengths[next]));
+		}
+	}
+	double equalTime = (BenchmarkNow() - start) / ((double)kBenchmarkRounds * count * 0x2);
+	
+	start = BenchmarkNow();
+	for (uint32_t query = 0x0; query < kBenchmarkQueries; query++) {
+		uint32_t target = (uint32_t)(((uint64_t)query * 0x9e3779b1) % count);
+		const char *suffix = copies[target] + (copies[target][0x0] == '_' ? 0x1 : 0x0);
+		uint64_t suffixLength = lengths[target] - (uint64_t)(suffix - copies[target]);
+		for (uint32_t i = 0x0; i < count; i++) {
+			if (suffixLength <= lengths[i])
+				sink += kernels->equal(names[i] + (lengths[i] - suffixLength), suffix, suffixLength);
+			calls++;
+		}
+	}
+	double suffixTime = (BenchmarkNow() - start) / (double)calls;
+	benchmarkSink = sink;
+	printf("%-8s strlen %6.2f ns  equal %6.2f ns  suffix %6.2f ns\n", kernels->name, lengthTime, equalTime, suffixTime);
+}
+
+int main(int argc, const char * argv[]) {
+	struct SDMMOLibrarySymbolTable *lib = SDMSTLoadLibrary((char*)(argc >= 2 ? argv[1] : argv[0]));
+	if (lib->symbolCount == 0x0) {
+		printf("No symbols to benchmark\n");
+		return 1;
+	}
+	char **names = (char **)calloc(lib->symbolCount, sizeof(char *));
+	char **copies = (char **)calloc(lib->symbolCount, sizeof(char *));
+	uint64_t *lengths = (uint64_t *)calloc(lib->symbolCount, sizeof(uint64_t));
+	uint64_t totalLength = 0x0;
+	for (uint32_t i = 0x0; i < lib->symbolCount; i++) {
+		names[i] = lib->table[i].name;
+		copies[i] = strdup(names[i]);
+		lengths[i] = strlen(names[i]);
+		totalLength += lengths[i];
+	}
+	printf("%i symbols, mean name length %.1f, active kernels: %s\n", lib->symbolCount, (double)totalLength / lib->symbolCount, SDMSTStringKernelsActive()->name);
+	for (uint32_t variant = SDMSTStringVariantScalar; variant < SDMSTStringVariantCount; variant++) {
+		const struct SDMSTStringKernels *kernels = SDMSTStringKernelsForVariant((SDMSTStringVariant)variant);
+		if (kernels)
+			BenchmarkVariant(kernels, names, copies, lengths, lib->symbolCount);
+	}
+	for (uint32_t i = 0x0; i < lib->symbolCount; i++)
+		free(copies[i]);
+	free(copies);
+	free(names);
+	free(lengths);
+	SDMSTLibraryRelease(lib);
+	return 0;
+}
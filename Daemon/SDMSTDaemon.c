@@ -0,0 +1,51 @@
+/*
+ *  SDMSTDaemon.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include "SDMSTServer.h"
+
+static struct SDMSTServer *daemonServer = NULL;
+
+void DaemonStop(int signal) {
+	(void)signal;
+	if (daemonServer)
+		SDMSTServerStop(daemonServer);
+}
+
+int main(int argc, const char * argv[]) {
+	if (argc < 2) {
+		printf("usage: %s <socket> [binary ...]\n", argv[0]);
+		return 1;
+	}
+	daemonServer = SDMSTServerCreate((char*)argv[1]);
+	for (int i = 0x2; i < argc; i++) {
+		uint32_t tableId = 0x0;
+		uint16_t status = SDMSTServerRegister(daemonServer, (char*)argv[i], NULL, &tableId);
+		if (status == kSDMSTStatusOK)
+			printf("[%s] table %i\n", argv[i], tableId);
+		else
+			printf("[%s] Unable to register: status %i\n", argv[i], status);
+	}
+	signal(SIGINT, DaemonStop);
+	signal(SIGTERM, DaemonStop);
+	signal(SIGPIPE, SIG_IGN);
+	bool served = SDMSTServerRun(daemonServer);
+	SDMSTServerRelease(daemonServer);
+	return (served ? 0 : 1);
+}
@@ -20,5 +20,313 @@
 #define _SDMMACHO_C_
 
 #include "SDMMachO.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define kSDMSTSegmentCommandHeaderSize 0x18
+
+uint32_t SDMSTReadBigEndian32(const uint8_t *bytes);
+uint64_t SDMSTReadBigEndian64(const uint8_t *bytes);
+void SDMSTSwapLongs(void *longs, uint64_t count);
+void SDMSTSwapSegmentCommand(struct load_command *loadCmd);
+
+struct SDMSTSeg64Data SDMSTSegmentData(void *segment, bool is64bit) {
+	struct SDMSTSeg64Data data = {0x0, 0x0, 0x0};
+	if (segment) {
+		if (is64bit) {
+			data = *(struct SDMSTSeg64Data *)((char*)segment + kSDMSTSegmentCommandHeaderSize);
+		} else {
+			struct SDMSTSeg32Data *data32 = (struct SDMSTSeg32Data *)((char*)segment + kSDMSTSegmentCommandHeaderSize);
+			data = (struct SDMSTSeg64Data){data32->vmaddr, data32->vmsize, data32->fileoff};
+		}
+	}
+	return data;
+}
+
+uint32_t SDMSTReadBigEndian32(const uint8_t *bytes) {
+	return ((uint32_t)bytes[0x0] << 24) | ((uint32_t)bytes[0x1] << 16) | ((uint32_t)bytes[0x2] << 8) | (uint32_t)bytes[0x3];
+}
+
+uint64_t SDMSTReadBigEndian64(const uint8_t *bytes) {
+	return ((uint64_t)SDMSTReadBigEndian32(bytes) << 32) | (uint64_t)SDMSTReadBigEndian32(bytes + 0x4);
+}
+
+bool SDMSTReadULEB128(const uint8_t **cursor, const uint8_t *end, uint64_t *value) {
+	uint64_t result = 0x0;
+	uint32_t shift = 0x0;
+	const uint8_t *p = *cursor;
+	while (p < end && shift < 64) {
+		uint8_t byte = *p++;
+		result |= (uint64_t)(byte & 0x7f) << shift;
+		shift += 0x7;
+		if (!(byte & 0x80)) {
+			*cursor = p;
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t SDMSTReadSlices(int fd, uint64_t fileSize, struct SDMSTFatSlice **slices) {
+	// A thin file is reported as one slice covering the whole file, so callers handle both shapes the same way.
+	uint32_t count = 0x0;
+	uint8_t header[kSDMSTFatHeaderSize];
+	*slices = NULL;
+	if (pread(fd, header, kSDMSTFatHeaderSize, 0x0) != kSDMSTFatHeaderSize)
+		return 0x0;
+	uint32_t magic = SDMSTReadBigEndian32(header);
+	if (magic == kSDMSTFatMagic || magic == kSDMSTFatMagic64) {
+		// fat_header and fat_arch(_64) are always big-endian on disk, whatever the host or slice byte order.
+		uint32_t archCount = SDMSTReadBigEndian32(header + 0x4);
+		uint32_t archSize = (magic == kSDMSTFatMagic64 ? kSDMSTFatArch64Size : kSDMSTFatArchSize);
+		if (archCount == 0x0 || archCount > kSDMSTFatMaximumArchs)
+			return 0x0;
+		uint8_t *archs = (uint8_t *)calloc(archCount, archSize);
+		if (pread(fd, archs, (size_t)archCount * archSize, kSDMSTFatHeaderSize) == (ssize_t)((size_t)archCount * archSize)) {
+			*slices = (struct SDMSTFatSlice *)calloc(archCount, sizeof(struct SDMSTFatSlice));
+			for (uint32_t i = 0x0; i < archCount; i++) {
+				uint8_t *arch = archs + (size_t)i * archSize;
+				struct SDMSTFatSlice slice;
+				slice.cputype = (cpu_type_t)SDMSTReadBigEndian32(arch);
+				slice.cpusubtype = (cpu_subtype_t)SDMSTReadBigEndian32(arch + 0x4);
+				if (magic == kSDMSTFatMagic64) {
+					slice.offset = SDMSTReadBigEndian64(arch + 0x8);
+					slice.size = SDMSTReadBigEndian64(arch + 0x10);
+					slice.align = SDMSTReadBigEndian32(arch + 0x18);
+				} else {
+					slice.offset = SDMSTReadBigEndian32(arch + 0x8);
+					slice.size = SDMSTReadBigEndian32(arch + 0xc);
+					slice.align = SDMSTReadBigEndian32(arch + 0x10);
+				}
+				if (slice.offset < fileSize && slice.size && slice.size <= fileSize - slice.offset) {
+					(*slices)[count] = slice;
+					count++;
+				}
+			}
+		}
+		free(archs);
+	} else {
+		struct mach_header thinHeader;
+		if (pread(fd, &thinHeader, sizeof(struct mach_header), 0x0) == sizeof(struct mach_header) && (thinHeader.magic == MH_MAGIC || thinHeader.magic == MH_MAGIC_64 || thinHeader.magic == MH_CIGAM || thinHeader.magic == MH_CIGAM_64)) {
+			if (thinHeader.magic == MH_CIGAM || thinHeader.magic == MH_CIGAM_64)
+				SDMSTSwapWords(&thinHeader, sizeof(struct mach_header) / sizeof(uint32_t));
+			*slices = (struct SDMSTFatSlice *)calloc(0x1, sizeof(struct SDMSTFatSlice));
+			(*slices)[0x0] = (struct SDMSTFatSlice){thinHeader.cputype, thinHeader.cpusubtype, 0x0, fileSize, 0x0};
+			count = 0x1;
+		}
+	}
+	if (count == 0x0) {
+		free(*slices);
+		*slices = NULL;
+	}
+	return count;
+}
+
+uint64_t SDMSTImageCommandsSize(const struct mach_header *header) {
+	// The header and its load commands, with sizeofcmds read in the header's own byte order; zero for anything else.
+	uint64_t size = 0x0;
+	switch (header->magic) {
+		case MH_MAGIC: {
+			size = sizeof(struct mach_header) + (uint64_t)header->sizeofcmds;
+			break;
+		};
+		case MH_MAGIC_64: {
+			size = sizeof(struct mach_header_64) + (uint64_t)header->sizeofcmds;
+			break;
+		};
+		case MH_CIGAM: {
+			size = sizeof(struct mach_header) + (uint64_t)__builtin_bswap32(header->sizeofcmds);
+			break;
+		};
+		case MH_CIGAM_64: {
+			size = sizeof(struct mach_header_64) + (uint64_t)__builtin_bswap32(header->sizeofcmds);
+			break;
+		};
+		default: {
+			break;
+		};
+	}
+	return size;
+}
+
+void SDMSTSwapWords(void *words, uint64_t count) {
+	uint8_t *word = (uint8_t *)words;
+	for (uint64_t i = 0x0; i < count; i++, word += sizeof(uint32_t)) {
+		uint32_t value;
+		memcpy(&value, word, sizeof(uint32_t));
+		value = __builtin_bswap32(value);
+		memcpy(word, &value, sizeof(uint32_t));
+	}
+}
+
+void SDMSTSwapLongs(void *longs, uint64_t count) {
+	uint8_t *word = (uint8_t *)longs;
+	for (uint64_t i = 0x0; i < count; i++, word += sizeof(uint64_t)) {
+		uint64_t value;
+		memcpy(&value, word, sizeof(uint64_t));
+		value = __builtin_bswap64(value);
+		memcpy(word, &value, sizeof(uint64_t));
+	}
+}
+
+void SDMSTSwapSymbolEntries(void *entries, uint64_t count, bool is64bit) {
+	// One pass over a whole nlist array: n_strx, n_desc and n_value change byte order, n_type and n_sect are single bytes.
+	uint64_t entrySize = sizeof(struct SDMSTSymbolTableListEntry) + (is64bit ? sizeof(uint64_t) : sizeof(uint32_t));
+	uint8_t *entry = (uint8_t *)entries;
+	for (uint64_t i = 0x0; i < count; i++, entry += entrySize) {
+		struct SDMSTSymbolTableListEntry fields;
+		memcpy(&fields, entry, sizeof(struct SDMSTSymbolTableListEntry));
+		fields.n_un.n_strx = __builtin_bswap32(fields.n_un.n_strx);
+		fields.n_desc = __builtin_bswap16(fields.n_desc);
+		memcpy(entry, &fields, sizeof(struct SDMSTSymbolTableListEntry));
+		if (is64bit)
+			SDMSTSwapLongs(entry + sizeof(struct SDMSTSymbolTableListEntry), 0x1);
+		else
+			SDMSTSwapWords(entry + sizeof(struct SDMSTSymbolTableListEntry), 0x1);
+	}
+}
+
+void SDMSTSwapSegmentCommand(struct load_command *loadCmd) {
+	// Segment and section names are bytes; addresses and sizes are 64-bit in LC_SEGMENT_64 and its sections.
+	bool is64bit = (loadCmd->cmd == LC_SEGMENT_64);
+	uint64_t segmentSize = (is64bit ? sizeof(struct segment_command_64) : sizeof(struct segment_command));
+	uint64_t sectionSize = (is64bit ? sizeof(struct section_64) : sizeof(struct section));
+	if (loadCmd->cmdsize < segmentSize)
+		return;
+	char *fields = (char*)loadCmd + kSDMSTSegmentCommandHeaderSize;
+	if (is64bit) {
+		SDMSTSwapLongs(fields, 0x4);
+		SDMSTSwapWords(fields + 0x4 * sizeof(uint64_t), 0x4);
+	} else {
+		SDMSTSwapWords(fields, 0x8);
+	}
+	uint32_t sectionCount = (is64bit ? ((struct segment_command_64 *)loadCmd)->nsects : ((struct segment_command *)loadCmd)->nsects);
+	char *section = (char*)loadCmd + segmentSize;
+	for (uint32_t i = 0x0; i < sectionCount && section + sectionSize <= (char*)loadCmd + loadCmd->cmdsize; i++, section += sectionSize) {
+		char *sectionFields = section + 0x2 * sizeof(((struct section *)section)->sectname);
+		if (is64bit) {
+			SDMSTSwapLongs(sectionFields, 0x2);
+			SDMSTSwapWords(sectionFields + 0x2 * sizeof(uint64_t), 0x8);
+		} else {
+			SDMSTSwapWords(sectionFields, 0x9);
+		}
+	}
+}
+
+bool SDMSTSwapImageCommands(void *image, uint64_t size) {
+	// Rewrites a foreign-endian header and its load commands in host order, magic included, so every later walk reads
+	// them exactly as it would a native image. Commands nothing here parses (thread state, versions, code signing) only
+	// have cmd and cmdsize swapped.
+	struct mach_header *header = (struct mach_header *)image;
+	if (size < sizeof(struct mach_header) || (header->magic != MH_CIGAM && header->magic != MH_CIGAM_64))
+		return false;
+	uint64_t headerSize = (header->magic == MH_CIGAM_64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header));
+	if (size < headerSize)
+		return false;
+	SDMSTSwapWords(image, headerSize / sizeof(uint32_t));
+	if (header->sizeofcmds > size - headerSize)
+		return false;
+	char *command = (char*)image + headerSize;
+	char *commandsEnd = command + header->sizeofcmds;
+	for (uint32_t i = 0x0; i < header->ncmds && command + sizeof(struct load_command) <= commandsEnd; i++) {
+		struct load_command *loadCmd = (struct load_command *)command;
+		SDMSTSwapWords(loadCmd, sizeof(struct load_command) / sizeof(uint32_t));
+		if (loadCmd->cmdsize < sizeof(struct load_command) || loadCmd->cmdsize > (uint64_t)(commandsEnd - command))
+			break;
+		// Everything after cmd and cmdsize in these commands is 32-bit fields; strings follow the dylib and rpath ones.
+		uint64_t fieldsSize = 0x0;
+		switch (loadCmd->cmd) {
+			case LC_SEGMENT:
+			case LC_SEGMENT_64: {
+				SDMSTSwapSegmentCommand(loadCmd);
+				break;
+			};
+			case LC_SYMTAB: {
+				fieldsSize = sizeof(struct symtab_command);
+				break;
+			};
+			case LC_DYSYMTAB: {
+				fieldsSize = sizeof(struct dysymtab_command);
+				break;
+			};
+			case LC_DYLD_INFO:
+			case LC_DYLD_INFO_ONLY: {
+				fieldsSize = sizeof(struct dyld_info_command);
+				break;
+			};
+			case LC_FUNCTION_STARTS:
+			case LC_DYLD_EXPORTS_TRIE: {
+				fieldsSize = sizeof(struct linkedit_data_command);
+				break;
+			};
+			case LC_ID_DYLIB:
+			case LC_LOAD_DYLIB:
+			case LC_LOAD_WEAK_DYLIB:
+			case LC_REEXPORT_DYLIB:
+			case LC_LAZY_LOAD_DYLIB:
+			case LC_LOAD_UPWARD_DYLIB: {
+				fieldsSize = sizeof(struct dylib_command);
+				break;
+			};
+			case LC_RPATH: {
+				fieldsSize = sizeof(struct rpath_command);
+				break;
+			};
+			default: {
+				break;
+			};
+		}
+		if (fieldsSize > sizeof(struct load_command) && fieldsSize <= loadCmd->cmdsize)
+			SDMSTSwapWords(command + sizeof(struct load_command), (fieldsSize - sizeof(struct load_command)) / sizeof(uint32_t));
+		command += loadCmd->cmdsize;
+	}
+	return true;
+}
+
+cpu_type_t SDMSTHostCPUType(void) {
+#if defined(__x86_64__)
+	return CPU_TYPE_X86_64;
+#elif defined(__i386__)
+	return CPU_TYPE_I386;
+#elif defined(__arm64__) || defined(__aarch64__)
+	return CPU_TYPE_ARM64;
+#elif defined(__arm__)
+	return CPU_TYPE_ARM;
+#elif defined(__ppc64__)
+	return CPU_TYPE_POWERPC64;
+#elif defined(__ppc__)
+	return CPU_TYPE_POWERPC;
+#else
+	return 0x0;
+#endif
+}
+
+int32_t SDMSTSelectSlice(struct SDMSTFatSlice *slices, uint32_t count, cpu_type_t cputype, cpu_subtype_t cpusubtype) {
+	// An explicit cputype must match; the subtype only breaks ties between slices of that cputype.
+	// With no cputype the host decides: its own architecture, then its 32-bit counterpart, then the first slice.
+	int32_t selected = -0x1;
+	if (cputype) {
+		for (uint32_t i = 0x0; i < count; i++)
+			if (slices[i].cputype == cputype) {
+				if ((slices[i].cpusubtype & ~CPU_SUBTYPE_MASK) == (cpusubtype & ~CPU_SUBTYPE_MASK))
+					return (int32_t)i;
+				if (selected < 0x0)
+					selected = (int32_t)i;
+			}
+	} else if (count) {
+		cpu_type_t host = SDMSTHostCPUType();
+		for (uint32_t i = 0x0; i < count && selected < 0x0; i++)
+			if (slices[i].cputype == host)
+				selected = (int32_t)i;
+		for (uint32_t i = 0x0; i < count && selected < 0x0; i++)
+			if (slices[i].cputype == (host & ~CPU_ARCH_ABI64))
+				selected = (int32_t)i;
+		if (selected < 0x0)
+			selected = 0x0;
+	}
+	return selected;
+}
 
 #endif
\ No newline at end of file
@@ -20,6 +20,18 @@
 #define _SDMMACHO_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "SDMMachOTypes.h"
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTFatMagic 0xcafebabe
+#define kSDMSTFatMagic64 0xcafebabf
+#define kSDMSTFatHeaderSize 0x8
+#define kSDMSTFatArchSize 0x14
+#define kSDMSTFatArch64Size 0x20
+#define kSDMSTFatMaximumArchs 0x40
 
 #pragma mark -
 #pragma mark Internal Types
@@ -45,6 +57,26 @@ typedef struct SDMSTSeg64Data {
 	uint64_t fileoff;
 } __attribute__ ((packed)) SDMSTSeg64Data;
 
+typedef struct SDMSTFatSlice {
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	uint64_t offset;
+	uint64_t size;
+	uint32_t align;
+} SDMSTFatSlice;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTSeg64Data SDMSTSegmentData(void *segment, bool is64bit);
+uint32_t SDMSTReadSlices(int fd, uint64_t fileSize, struct SDMSTFatSlice **slices);
+int32_t SDMSTSelectSlice(struct SDMSTFatSlice *slices, uint32_t count, cpu_type_t cputype, cpu_subtype_t cpusubtype);
+cpu_type_t SDMSTHostCPUType(void);
+bool SDMSTReadULEB128(const uint8_t **cursor, const uint8_t *end, uint64_t *value);
+uint64_t SDMSTImageCommandsSize(const struct mach_header *header);
+void SDMSTSwapWords(void *words, uint64_t count);
+void SDMSTSwapSymbolEntries(void *entries, uint64_t count, bool is64bit);
+bool SDMSTSwapImageCommands(void *image, uint64_t size);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,309 @@
+/*
+ *  SDMMachOTypes.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMMACHOTYPES_H_
+#define _SDMMACHOTYPES_H_
+
+#include <stdint.h>
+
+/*
+ *	Mach-O definitions used by the file-based loader. On Apple platforms these come from the SDK; elsewhere the subset the
+ *	library needs is declared here with the same names and layouts, so the parsing code is identical on both.
+ */
+
+#ifdef __APPLE__
+
+#include <mach/machine.h>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+#include <mach-o/fat.h>
+
+#else
+
+#pragma mark -
+#pragma mark Machine Types
+
+typedef int32_t cpu_type_t;
+typedef int32_t cpu_subtype_t;
+typedef int vm_prot_t;
+
+#define CPU_ARCH_ABI64 0x01000000
+#define CPU_TYPE_X86 ((cpu_type_t)7)
+#define CPU_TYPE_I386 CPU_TYPE_X86
+#define CPU_TYPE_X86_64 (CPU_TYPE_X86 | CPU_ARCH_ABI64)
+#define CPU_TYPE_ARM ((cpu_type_t)12)
+#define CPU_TYPE_ARM64 (CPU_TYPE_ARM | CPU_ARCH_ABI64)
+#define CPU_TYPE_POWERPC ((cpu_type_t)18)
+#define CPU_TYPE_POWERPC64 (CPU_TYPE_POWERPC | CPU_ARCH_ABI64)
+
+#define CPU_SUBTYPE_MASK 0xff000000
+#define CPU_SUBTYPE_ARM_V6 ((cpu_subtype_t)6)
+#define CPU_SUBTYPE_ARM_V7 ((cpu_subtype_t)9)
+
+#pragma mark -
+#pragma mark Headers
+
+struct mach_header {
+	uint32_t magic;
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	uint32_t filetype;
+	uint32_t ncmds;
+	uint32_t sizeofcmds;
+	uint32_t flags;
+};
+
+struct mach_header_64 {
+	uint32_t magic;
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	uint32_t filetype;
+	uint32_t ncmds;
+	uint32_t sizeofcmds;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+#define MH_MAGIC 0xfeedface
+#define MH_CIGAM 0xcefaedfe
+#define MH_MAGIC_64 0xfeedfacf
+#define MH_CIGAM_64 0xcffaedfe
+
+#define MH_EXECUTE 0x2
+#define MH_DYLIB 0x6
+
+struct fat_header {
+	uint32_t magic;
+	uint32_t nfat_arch;
+};
+
+struct fat_arch {
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t align;
+};
+
+#define FAT_MAGIC 0xcafebabe
+#define FAT_CIGAM 0xbebafeca
+
+#pragma mark -
+#pragma mark Load Commands
+
+struct load_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+};
+
+#define LC_REQ_DYLD 0x80000000
+#define LC_SEGMENT 0x1
+#define LC_SYMTAB 0x2
+#define LC_DYSYMTAB 0xb
+#define LC_LOAD_DYLIB 0xc
+#define LC_ID_DYLIB 0xd
+#define LC_LOAD_WEAK_DYLIB (0x18 | LC_REQ_DYLD)
+#define LC_SEGMENT_64 0x19
+#define LC_UUID 0x1b
+#define LC_RPATH (0x1c | LC_REQ_DYLD)
+#define LC_REEXPORT_DYLIB (0x1f | LC_REQ_DYLD)
+#define LC_LAZY_LOAD_DYLIB 0x20
+#define LC_DYLD_INFO 0x22
+#define LC_DYLD_INFO_ONLY (0x22 | LC_REQ_DYLD)
+#define LC_LOAD_UPWARD_DYLIB (0x23 | LC_REQ_DYLD)
+#define LC_FUNCTION_STARTS 0x26
+#define LC_DYLD_EXPORTS_TRIE (0x33 | LC_REQ_DYLD)
+
+union lc_str {
+	uint32_t offset;
+};
+
+struct segment_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	char segname[16];
+	uint32_t vmaddr;
+	uint32_t vmsize;
+	uint32_t fileoff;
+	uint32_t filesize;
+	vm_prot_t maxprot;
+	vm_prot_t initprot;
+	uint32_t nsects;
+	uint32_t flags;
+};
+
+struct segment_command_64 {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	char segname[16];
+	uint64_t vmaddr;
+	uint64_t vmsize;
+	uint64_t fileoff;
+	uint64_t filesize;
+	vm_prot_t maxprot;
+	vm_prot_t initprot;
+	uint32_t nsects;
+	uint32_t flags;
+};
+
+struct section {
+	char sectname[16];
+	char segname[16];
+	uint32_t addr;
+	uint32_t size;
+	uint32_t offset;
+	uint32_t align;
+	uint32_t reloff;
+	uint32_t nreloc;
+	uint32_t flags;
+	uint32_t reserved1;
+	uint32_t reserved2;
+};
+
+struct section_64 {
+	char sectname[16];
+	char segname[16];
+	uint64_t addr;
+	uint64_t size;
+	uint32_t offset;
+	uint32_t align;
+	uint32_t reloff;
+	uint32_t nreloc;
+	uint32_t flags;
+	uint32_t reserved1;
+	uint32_t reserved2;
+	uint32_t reserved3;
+};
+
+#define SEG_TEXT "__TEXT"
+#define SEG_LINKEDIT "__LINKEDIT"
+
+#define SECTION_TYPE 0x000000ff
+#define S_NON_LAZY_SYMBOL_POINTERS 0x6
+#define S_LAZY_SYMBOL_POINTERS 0x7
+#define S_SYMBOL_STUBS 0x8
+#define S_LAZY_DYLIB_SYMBOL_POINTERS 0x10
+#define S_THREAD_LOCAL_VARIABLE_POINTERS 0x14
+#define S_ATTR_PURE_INSTRUCTIONS 0x80000000
+#define S_ATTR_SOME_INSTRUCTIONS 0x00000400
+
+struct dylib {
+	union lc_str name;
+	uint32_t timestamp;
+	uint32_t current_version;
+	uint32_t compatibility_version;
+};
+
+struct dylib_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	struct dylib dylib;
+};
+
+struct rpath_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	union lc_str path;
+};
+
+struct symtab_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	uint32_t symoff;
+	uint32_t nsyms;
+	uint32_t stroff;
+	uint32_t strsize;
+};
+
+struct dysymtab_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	uint32_t ilocalsym;
+	uint32_t nlocalsym;
+	uint32_t iextdefsym;
+	uint32_t nextdefsym;
+	uint32_t iundefsym;
+	uint32_t nundefsym;
+	uint32_t tocoff;
+	uint32_t ntoc;
+	uint32_t modtaboff;
+	uint32_t nmodtab;
+	uint32_t extrefsymoff;
+	uint32_t nextrefsyms;
+	uint32_t indirectsymoff;
+	uint32_t nindirectsyms;
+	uint32_t extreloff;
+	uint32_t nextrel;
+	uint32_t locreloff;
+	uint32_t nlocrel;
+};
+
+#define INDIRECT_SYMBOL_LOCAL 0x80000000
+#define INDIRECT_SYMBOL_ABS 0x40000000
+
+struct uuid_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	uint8_t uuid[16];
+};
+
+struct linkedit_data_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	uint32_t dataoff;
+	uint32_t datasize;
+};
+
+struct dyld_info_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	uint32_t rebase_off;
+	uint32_t rebase_size;
+	uint32_t bind_off;
+	uint32_t bind_size;
+	uint32_t weak_bind_off;
+	uint32_t weak_bind_size;
+	uint32_t lazy_bind_off;
+	uint32_t lazy_bind_size;
+	uint32_t export_off;
+	uint32_t export_size;
+};
+
+#define EXPORT_SYMBOL_FLAGS_KIND_MASK 0x03
+#define EXPORT_SYMBOL_FLAGS_KIND_REGULAR 0x00
+#define EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL 0x01
+#define EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE 0x02
+#define EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION 0x04
+#define EXPORT_SYMBOL_FLAGS_REEXPORT 0x08
+#define EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER 0x10
+
+#pragma mark -
+#pragma mark Symbol Table
+
+#define N_STAB 0xe0
+#define N_PEXT 0x10
+#define N_TYPE 0x0e
+#define N_EXT 0x01
+#define N_UNDF 0x0
+#define N_ABS 0x2
+#define N_SECT 0xe
+#define N_INDR 0xa
+
+#endif
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ *  SDMSTAddressIndex.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTADDRESSINDEX_C_
+#define _SDMSTADDRESSINDEX_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTAddressIndex.h"
+
+#pragma mark -
+#pragma mark Declarations
+
+uint32_t SDMSTAddressIndexFillLayout(struct SDMSTAddressIndex *index, uint32_t position, uint64_t node);
+uint32_t SDMSTAddressIndexSearch(struct SDMSTAddressIndex *index, uintptr_t address, bool inclusive);
+uint32_t SDMSTAddressIndexPageUpperBound(struct SDMSTAddressIndex *index, uintptr_t address);
+int SDMSTCompareAddressRanges(const void *entry1, const void *entry2);
+
+#pragma mark -
+#pragma mark Functions
+
+uint32_t SDMSTAddressIndexFillLayout(struct SDMSTAddressIndex *index, uint32_t position, uint64_t node) {
+	if (node <= index->count) {
+		position = SDMSTAddressIndexFillLayout(index, position, node << 1);
+		index->layout[node] = index->offsets[position];
+		index->layoutIndex[node] = position;
+		position = SDMSTAddressIndexFillLayout(index, position + 0x1, (node << 1) + 0x1);
+	}
+	return position;
+}
+
+struct SDMSTAddressIndex* SDMSTAddressIndexCreate(uintptr_t *sortedOffsets, uint32_t count) {
+	struct SDMSTAddressIndex *index = (struct SDMSTAddressIndex *)calloc(0x1, sizeof(struct SDMSTAddressIndex));
+	index->offsets = sortedOffsets;
+	index->count = count;
+	// Past a few L1s worth of keys the top of a plain binary search misses on every level; the Eytzinger order keeps each level's candidates in one line.
+	if (count >= kSDMSTAddressIndexEytzingerMinimum) {
+		index->layout = (uintptr_t *)calloc(count + 0x1, sizeof(uintptr_t));
+		index->layoutIndex = (uint32_t *)calloc(count + 0x1, sizeof(uint32_t));
+		SDMSTAddressIndexFillLayout(index, 0x0, 0x1);
+	}
+	return index;
+}
+
+uint32_t SDMSTAddressIndexSearch(struct SDMSTAddressIndex *index, uintptr_t address, bool inclusive) {
+	uint32_t result = 0x0;
+	if (index && index->count) {
+		if (index->layout) {
+			uint64_t node = 0x1;
+			while (node <= index->count) {
+				__builtin_prefetch(index->layout + (node << 3));
+				node = (node << 1) + (inclusive ? (index->layout[node] <= address) : (index->layout[node] < address));
+			}
+			node >>= __builtin_ffsll(~node);
+			result = (node ? index->layoutIndex[node] : index->count);
+		} else {
+			const uintptr_t *base = index->offsets;
+			uint32_t length = index->count;
+			while (length > 0x1) {
+				uint32_t half = length >> 1;
+				base = ((inclusive ? (base[half] <= address) : (base[half] < address)) ? &base[half] : base);
+				length -= half;
+			}
+			result = (uint32_t)(base - index->offsets) + (inclusive ? (*base <= address) : (*base < address));
+		}
+	}
+	return result;
+}
+
+uint32_t SDMSTAddressIndexPageUpperBound(struct SDMSTAddressIndex *index, uintptr_t address) {
+	struct SDMSTPageIndexEntry *page = &(index->pageIndex->pages[(address - index->pageIndex->start) >> kSDMSTPageIndexPageShift]);
+	uint32_t candidate = page->first;
+	if (page->count <= kSDMSTPageIndexMaximumScan) {
+		uint32_t last = page->first + page->count;
+		while (candidate < last && index->offsets[candidate+0x1] <= address)
+			candidate++;
+	} else {
+		const uintptr_t *base = &(index->offsets[page->first + 0x1]);
+		uint32_t length = page->count;
+		while (length > 0x1) {
+			uint32_t half = length >> 1;
+			base = ((base[half] <= address) ? &base[half] : base);
+			length -= half;
+		}
+		candidate = (uint32_t)(base - index->offsets) - ((*base <= address) ? 0x0 : 0x1);
+	}
+	return candidate + (index->offsets[candidate] <= address ? 0x1 : 0x0);
+}
+
+uint32_t SDMSTAddressIndexUpperBound(struct SDMSTAddressIndex *index, uintptr_t address) {
+	if (index && index->pageIndex && address >= index->pageIndex->start && address < index->pageIndex->end)
+		return SDMSTAddressIndexPageUpperBound(index, address);
+	return SDMSTAddressIndexSearch(index, address, true);
+}
+
+uint32_t SDMSTAddressIndexLowerBound(struct SDMSTAddressIndex *index, uintptr_t address) {
+	return SDMSTAddressIndexSearch(index, address, false);
+}
+
+int SDMSTCompareAddressRanges(const void *entry1, const void *entry2) {
+	const struct SDMSTAddressRange *range1 = (const struct SDMSTAddressRange *)entry1;
+	const struct SDMSTAddressRange *range2 = (const struct SDMSTAddressRange *)entry2;
+	return (range1->start < range2->start ? -1 : (range1->start > range2->start ? 1 : 0));
+}
+
+void SDMSTAddressIndexSetRanges(struct SDMSTAddressIndex *index, struct SDMSTAddressRange *ranges, uint32_t count) {
+	// Takes ownership of ranges. These are the extents symbols may cover (an image's sections); a symbol reaches no
+	// further than the end of the range it starts in.
+	if (index == NULL) {
+		free(ranges);
+		return;
+	}
+	qsort(ranges, count, sizeof(struct SDMSTAddressRange), SDMSTCompareAddressRanges);
+	free(index->ranges);
+	index->ranges = ranges;
+	index->rangeCount = count;
+}
+
+uintptr_t SDMSTAddressIndexRangeEnd(struct SDMSTAddressIndex *index, uintptr_t address) {
+	// The end of the range holding address; address itself when no range holds it, and UINTPTR_MAX when no ranges are known.
+	if (index == NULL || index->rangeCount == 0x0)
+		return UINTPTR_MAX;
+	uint32_t low = 0x0, high = index->rangeCount;
+	while (low < high) {
+		uint32_t middle = low + ((high - low) >> 1);
+		if (index->ranges[middle].start <= address)
+			low = middle + 0x1;
+		else
+			high = middle;
+	}
+	return (low && address < index->ranges[low - 0x1].end ? index->ranges[low - 0x1].end : address);
+}
+
+bool SDMSTAddressIndexCovers(struct SDMSTAddressIndex *index, uint32_t symbol, uintptr_t address) {
+	// Whether address falls in the symbol at index symbol, given it is the last one starting at or before address.
+	return (symbol < index->count && index->offsets[symbol] <= address && (address == index->offsets[symbol] || address < SDMSTAddressIndexRangeEnd(index, index->offsets[symbol])));
+}
+
+uint64_t SDMSTAddressIndexMemorySize(struct SDMSTAddressIndex *index) {
+	uint64_t size = 0x0;
+	if (index) {
+		size = sizeof(struct SDMSTAddressIndex) + (uint64_t)index->count * sizeof(uintptr_t);
+		if (index->layout)
+			size += ((uint64_t)index->count + 0x1) * (sizeof(uintptr_t) + sizeof(uint32_t));
+		size += (uint64_t)index->rangeCount * sizeof(struct SDMSTAddressRange);
+	}
+	return size;
+}
+
+uint64_t SDMSTAddressIndexBuildPages(struct SDMSTAddressIndex *index, uintptr_t start, uintptr_t end) {
+	if (index && index->pageIndex == NULL && index->count && end > start) {
+		struct SDMSTPageIndex *pageIndex = (struct SDMSTPageIndex *)calloc(0x1, sizeof(struct SDMSTPageIndex));
+		pageIndex->start = start & ~(((uintptr_t)0x1 << kSDMSTPageIndexPageShift) - 0x1);
+		pageIndex->end = end;
+		pageIndex->pageCount = (uint32_t)(((end - pageIndex->start) + ((uintptr_t)0x1 << kSDMSTPageIndexPageShift) - 0x1) >> kSDMSTPageIndexPageShift);
+		pageIndex->pages = (struct SDMSTPageIndexEntry *)calloc(pageIndex->pageCount, sizeof(struct SDMSTPageIndexEntry));
+		// Each page records the symbol covering its first byte plus how many more start inside it, so a lookup is one load and a short scan.
+		uint32_t cursor = 0x0;
+		for (uint32_t page = 0x0; page < pageIndex->pageCount; page++) {
+			uintptr_t pageStart = pageIndex->start + ((uintptr_t)page << kSDMSTPageIndexPageShift);
+			uintptr_t pageEnd = pageStart + ((uintptr_t)0x1 << kSDMSTPageIndexPageShift);
+			while (cursor < index->count && index->offsets[cursor] <= pageStart)
+				cursor++;
+			uint32_t last = cursor;
+			while (last < index->count && index->offsets[last] < pageEnd)
+				last++;
+			if (cursor) {
+				pageIndex->pages[page] = (struct SDMSTPageIndexEntry){cursor - 0x1, last - cursor};
+			} else {
+				pageIndex->pages[page] = (struct SDMSTPageIndexEntry){0x0, (last ? last - 0x1 : 0x0)};
+			}
+		}
+		index->pageIndex = pageIndex;
+	}
+	return SDMSTAddressIndexPagesMemorySize(index);
+}
+
+uint64_t SDMSTAddressIndexPagesMemorySize(struct SDMSTAddressIndex *index) {
+	uint64_t size = 0x0;
+	if (index && index->pageIndex)
+		size = sizeof(struct SDMSTPageIndex) + (uint64_t)index->pageIndex->pageCount * sizeof(struct SDMSTPageIndexEntry);
+	return size;
+}
+
+void SDMSTAddressIndexRelease(struct SDMSTAddressIndex *index) {
+	if (index) {
+		if (index->pageIndex)
+			free(index->pageIndex->pages);
+		free(index->pageIndex);
+		free(index->layoutIndex);
+		free(index->layout);
+		free(index->offsets);
+		free(index->ranges);
+		free(index);
+	}
+}
+
+#endif
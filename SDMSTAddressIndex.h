@@ -0,0 +1,79 @@
+/*
+ *  SDMSTAddressIndex.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTADDRESSINDEX_H_
+#define _SDMSTADDRESSINDEX_H_
+
+#pragma mark -
+#pragma mark Includes
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTAddressIndexEytzingerMinimum 0x2000
+#define kSDMSTPageIndexPageShift 0xc
+#define kSDMSTPageIndexMaximumScan 0x10
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTPageIndexEntry {
+	uint32_t first;
+	uint32_t count;
+} __attribute__ ((packed)) SDMSTPageIndexEntry;
+
+typedef struct SDMSTPageIndex {
+	uintptr_t start;
+	uintptr_t end;
+	uint32_t pageCount;
+	struct SDMSTPageIndexEntry *pages;
+} SDMSTPageIndex;
+
+typedef struct SDMSTAddressRange {
+	uintptr_t start;
+	uintptr_t end;
+} SDMSTAddressRange;
+
+typedef struct SDMSTAddressIndex {
+	uintptr_t *offsets;
+	uintptr_t *layout;
+	uint32_t *layoutIndex;
+	uint32_t count;
+	struct SDMSTPageIndex *pageIndex;
+	struct SDMSTAddressRange *ranges;
+	uint32_t rangeCount;
+} SDMSTAddressIndex;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTAddressIndex* SDMSTAddressIndexCreate(uintptr_t *sortedOffsets, uint32_t count);
+uint32_t SDMSTAddressIndexUpperBound(struct SDMSTAddressIndex *index, uintptr_t address);
+uint32_t SDMSTAddressIndexLowerBound(struct SDMSTAddressIndex *index, uintptr_t address);
+void SDMSTAddressIndexSetRanges(struct SDMSTAddressIndex *index, struct SDMSTAddressRange *ranges, uint32_t count);
+uintptr_t SDMSTAddressIndexRangeEnd(struct SDMSTAddressIndex *index, uintptr_t address);
+bool SDMSTAddressIndexCovers(struct SDMSTAddressIndex *index, uint32_t symbol, uintptr_t address);
+uint64_t SDMSTAddressIndexMemorySize(struct SDMSTAddressIndex *index);
+uint64_t SDMSTAddressIndexBuildPages(struct SDMSTAddressIndex *index, uintptr_t start, uintptr_t end);
+uint64_t SDMSTAddressIndexPagesMemorySize(struct SDMSTAddressIndex *index);
+void SDMSTAddressIndexRelease(struct SDMSTAddressIndex *index);
+
+#endif
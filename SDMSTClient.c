@@ -0,0 +1,153 @@
+/*
+ *  SDMSTClient.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTCLIENT_C_
+#define _SDMSTCLIENT_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTClient.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#pragma mark -
+#pragma mark Declarations
+
+uint16_t SDMSTClientTransact(struct SDMSTClient *client, uint16_t opcode, uint32_t tableId, const void *payload, uint32_t length, uint32_t *replyLength);
+
+#pragma mark -
+#pragma mark Functions
+
+struct SDMSTClient* SDMSTClientConnect(char *socketPath) {
+	struct SDMSTClient *client = NULL;
+	struct sockaddr_un address;
+	memset(&address, 0x0, sizeof(struct sockaddr_un));
+	address.sun_family = AF_UNIX;
+	if (socketPath && strlen(socketPath) < sizeof(address.sun_path)) {
+		strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 0x1);
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0x0);
+		if (fd >= 0x0 && connect(fd, (struct sockaddr *)&address, sizeof(struct sockaddr_un)) == 0x0) {
+			SDMSTProtocolConfigureSocket(fd);
+			client = (struct SDMSTClient *)calloc(0x1, sizeof(struct SDMSTClient));
+			client->fd = fd;
+		} else if (fd >= 0x0) {
+			close(fd);
+		}
+	}
+	return client;
+}
+
+uint16_t SDMSTClientTransact(struct SDMSTClient *client, uint16_t opcode, uint32_t tableId, const void *payload, uint32_t length, uint32_t *replyLength) {
+	// Replies land in the client's buffer, which stays valid until the next call on this client.
+	struct SDMSTRequestHeader request = {kSDMSTProtocolMagic, kSDMSTProtocolVersion, opcode, tableId, length};
+	struct SDMSTResponseHeader response;
+	*replyLength = 0x0;
+	if (!SDMSTProtocolSendMessage(client->fd, &request, sizeof(struct SDMSTRequestHeader), payload, length))
+		return kSDMSTStatusTransportError;
+	if (!SDMSTProtocolReceive(client->fd, &response, sizeof(struct SDMSTResponseHeader)) || response.magic != kSDMSTProtocolMagic || response.length > UINT32_MAX - 0x1)
+		return kSDMSTStatusTransportError;
+	if (response.length + 0x1 > client->bufferCapacity) {
+		client->buffer = realloc(client->buffer, response.length + 0x1);
+		client->bufferCapacity = response.length + 0x1;
+	}
+	if (!SDMSTProtocolReceive(client->fd, client->buffer, response.length))
+		return kSDMSTStatusTransportError;
+	*replyLength = response.length;
+	return response.status;
+}
+
+uint16_t SDMSTClientRegister(struct SDMSTClient *client, char *path, uint8_t *expectedUUID, struct SDMSTClientTable *table) {
+	uint32_t pathLength = (uint32_t)strlen(path);
+	char *payload = (char *)calloc(kSDMSTProtocolUUIDSize + pathLength, sizeof(char));
+	if (expectedUUID)
+		memcpy(payload, expectedUUID, kSDMSTProtocolUUIDSize);
+	memcpy(payload + kSDMSTProtocolUUIDSize, path, pathLength);
+	uint32_t replyLength = 0x0;
+	uint16_t status = SDMSTClientTransact(client, kSDMSTOpRegister, 0x0, payload, kSDMSTProtocolUUIDSize + pathLength, &replyLength);
+	free(payload);
+	if (status == kSDMSTStatusOK) {
+		if (replyLength != sizeof(struct SDMSTRegisterReply))
+			return kSDMSTStatusTransportError;
+		struct SDMSTRegisterReply *reply = (struct SDMSTRegisterReply *)client->buffer;
+		table->tableId = reply->tableId;
+		memcpy(table->uuid, reply->uuid, kSDMSTProtocolUUIDSize);
+		table->symbolCount = reply->symbolCount;
+		table->textAddress = reply->textAddress;
+		table->textSize = reply->textSize;
+	}
+	return status;
+}
+
+uint16_t SDMSTClientLookupName(struct SDMSTClient *client, uint32_t tableId, char *name, uint64_t *address) {
+	uint32_t replyLength = 0x0;
+	uint16_t status = SDMSTClientTransact(client, kSDMSTOpLookupName, tableId, name, (uint32_t)strlen(name), &replyLength);
+	if (status == kSDMSTStatusOK) {
+		if (replyLength != sizeof(uint64_t))
+			return kSDMSTStatusTransportError;
+		*address = *(uint64_t *)client->buffer;
+	}
+	return status;
+}
+
+uint16_t SDMSTClientLookupAddress(struct SDMSTClient *client, uint32_t tableId, uint64_t address, struct SDMSTClientSymbol *symbol) {
+	uint32_t replyLength = 0x0;
+	uint16_t status = SDMSTClientTransact(client, kSDMSTOpLookupAddress, tableId, &address, sizeof(uint64_t), &replyLength);
+	if (status == kSDMSTStatusOK) {
+		struct SDMSTSymbolReply *reply = (struct SDMSTSymbolReply *)client->buffer;
+		if (replyLength < sizeof(struct SDMSTSymbolReply) || replyLength - sizeof(struct SDMSTSymbolReply) != reply->nameLength)
+			return kSDMSTStatusTransportError;
+		client->buffer[replyLength] = '\0';
+		*symbol = (struct SDMSTClientSymbol){reply->address, reply->offset, client->buffer + sizeof(struct SDMSTSymbolReply), reply->nameLength};
+	}
+	return status;
+}
+
+uint16_t SDMSTClientSymbolizeAddresses(struct SDMSTClient *client, uint32_t tableId, uint64_t *addresses, uint32_t count, struct SDMSTClientSymbol *symbols) {
+	// Names are not NUL-terminated in a batch reply; use nameLength. An unresolved address comes back with a NULL name.
+	if ((uint64_t)count * sizeof(uint64_t) > kSDMSTProtocolMaximumPayload)
+		return kSDMSTStatusBadRequest;
+	uint32_t replyLength = 0x0;
+	uint16_t status = SDMSTClientTransact(client, kSDMSTOpSymbolizeBatch, tableId, addresses, count * sizeof(uint64_t), &replyLength);
+	if (status == kSDMSTStatusOK) {
+		uint64_t replyArray = (uint64_t)count * sizeof(struct SDMSTSymbolReply);
+		if (replyLength < replyArray)
+			return kSDMSTStatusTransportError;
+		struct SDMSTSymbolReply *replies = (struct SDMSTSymbolReply *)client->buffer;
+		char *names = client->buffer + replyArray;
+		for (uint32_t i = 0x0; i < count; i++) {
+			if (replies[i].nameOffset == kSDMSTSymbolReplyUnresolved || (uint64_t)replies[i].nameOffset + replies[i].nameLength > replyLength - replyArray)
+				symbols[i] = (struct SDMSTClientSymbol){0x0, 0x0, NULL, 0x0};
+			else
+				symbols[i] = (struct SDMSTClientSymbol){replies[i].address, replies[i].offset, names + replies[i].nameOffset, replies[i].nameLength};
+		}
+	}
+	return status;
+}
+
+void SDMSTClientRelease(struct SDMSTClient *client) {
+	if (client) {
+		close(client->fd);
+		free(client->buffer);
+		free(client);
+	}
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ *  SDMSTClient.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTCLIENT_H_
+#define _SDMSTCLIENT_H_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTProtocol.h"
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTClientTable {
+	uint32_t tableId;
+	uint8_t uuid[kSDMSTProtocolUUIDSize];
+	uint32_t symbolCount;
+	uint64_t textAddress;
+	uint64_t textSize;
+} SDMSTClientTable;
+
+typedef struct SDMSTClientSymbol {
+	uint64_t address;
+	uint64_t offset;
+	const char *name;
+	uint32_t nameLength;
+} SDMSTClientSymbol;
+
+typedef struct SDMSTClient {
+	int fd;
+	char *buffer;
+	uint32_t bufferCapacity;
+} SDMSTClient;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTClient* SDMSTClientConnect(char *socketPath);
+uint16_t SDMSTClientRegister(struct SDMSTClient *client, char *path, uint8_t *expectedUUID, struct SDMSTClientTable *table);
+uint16_t SDMSTClientLookupName(struct SDMSTClient *client, uint32_t tableId, char *name, uint64_t *address);
+uint16_t SDMSTClientLookupAddress(struct SDMSTClient *client, uint32_t tableId, uint64_t address, struct SDMSTClientSymbol *symbol);
+uint16_t SDMSTClientSymbolizeAddresses(struct SDMSTClient *client, uint32_t tableId, uint64_t *addresses, uint32_t count, struct SDMSTClientSymbol *symbols);
+void SDMSTClientRelease(struct SDMSTClient *client);
+
+#endif
@@ -0,0 +1,275 @@
+/*
+ *  SDMSTCommandIndex.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTCOMMANDINDEX_C_
+#define _SDMSTCOMMANDINDEX_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTCommandIndex.h"
+#include "SDMSTPerfectHash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#pragma mark -
+#pragma mark Declarations
+
+uint32_t SDMSTCommandMinimumSize(uint32_t cmd);
+uint64_t SDMSTSegmentNameHash(const char *segname);
+uint64_t SDMSTSectionNameHash(const char *segname, const char *sectname);
+void SDMSTCommandIndexSegment(struct SDMSTCommandIndex *index, struct load_command *loadCmd);
+void SDMSTCommandIndexNames(struct SDMSTCommandIndex *index);
+
+#pragma mark -
+#pragma mark Functions
+
+uint32_t SDMSTCommandMinimumSize(uint32_t cmd) {
+	// The fixed part of each command something here reads; a command shorter than that is left out of the index.
+	uint32_t size = sizeof(struct load_command);
+	switch (cmd) {
+		case LC_SEGMENT: {
+			size = sizeof(struct segment_command);
+			break;
+		};
+		case LC_SEGMENT_64: {
+			size = sizeof(struct segment_command_64);
+			break;
+		};
+		case LC_SYMTAB: {
+			size = sizeof(struct symtab_command);
+			break;
+		};
+		case LC_DYSYMTAB: {
+			size = sizeof(struct dysymtab_command);
+			break;
+		};
+		case LC_DYLD_INFO:
+		case LC_DYLD_INFO_ONLY: {
+			size = sizeof(struct dyld_info_command);
+			break;
+		};
+		case LC_FUNCTION_STARTS:
+		case LC_DYLD_EXPORTS_TRIE: {
+			size = sizeof(struct linkedit_data_command);
+			break;
+		};
+		case LC_UUID: {
+			size = sizeof(struct uuid_command);
+			break;
+		};
+		case LC_ID_DYLIB:
+		case LC_LOAD_DYLIB:
+		case LC_LOAD_WEAK_DYLIB:
+		case LC_REEXPORT_DYLIB:
+		case LC_LAZY_LOAD_DYLIB:
+		case LC_LOAD_UPWARD_DYLIB: {
+			size = sizeof(struct dylib_command);
+			break;
+		};
+		case LC_RPATH: {
+			size = sizeof(struct rpath_command);
+			break;
+		};
+		default: {
+			break;
+		};
+	}
+	return size;
+}
+
+uint64_t SDMSTSegmentNameHash(const char *segname) {
+	return SDMSTHashName(segname, strnlen(segname, 0x10), 0x0);
+}
+
+uint64_t SDMSTSectionNameHash(const char *segname, const char *sectname) {
+	return SDMSTHashName(sectname, strnlen(sectname, 0x10), SDMSTSegmentNameHash(segname));
+}
+
+void SDMSTCommandIndexSegment(struct SDMSTCommandIndex *index, struct load_command *loadCmd) {
+	// 32- and 64-bit segments and sections are widened into one layout, keeping only the sections inside the command.
+	struct SDMSTSegmentInfo segment;
+	uint32_t sectionCount = 0x0;
+	uint64_t segmentSize = (index->is64bit ? sizeof(struct segment_command_64) : sizeof(struct segment_command));
+	uint64_t sectionSize = (index->is64bit ? sizeof(struct section_64) : sizeof(struct section));
+	if (index->is64bit) {
+		struct segment_command_64 *seg = (struct segment_command_64 *)loadCmd;
+		segment = (struct SDMSTSegmentInfo){{0x0}, seg->vmaddr, seg->vmsize, seg->fileoff, seg->filesize, seg->flags, 0x0, 0x0, loadCmd};
+		sectionCount = seg->nsects;
+	} else {
+		struct segment_command *seg = (struct segment_command *)loadCmd;
+		segment = (struct SDMSTSegmentInfo){{0x0}, seg->vmaddr, seg->vmsize, seg->fileoff, seg->filesize, seg->flags, 0x0, 0x0, loadCmd};
+		sectionCount = seg->nsects;
+	}
+	// segname sits at the same offset in both segment commands, as do the names in both section layouts.
+	memcpy(segment.name, ((struct segment_command *)loadCmd)->segname, sizeof(segment.name));
+	uint64_t fitting = (loadCmd->cmdsize - segmentSize) / sectionSize;
+	if (sectionCount > fitting)
+		sectionCount = (uint32_t)fitting;
+	segment.firstSection = index->sectionCount;
+	segment.sectionCount = sectionCount;
+	index->sections = realloc(index->sections, sizeof(struct SDMSTSectionInfo) * (index->sectionCount + sectionCount + 0x1));
+	char *section = (char*)loadCmd + segmentSize;
+	for (uint32_t i = 0x0; i < sectionCount; i++, section += sectionSize) {
+		struct SDMSTSectionInfo *info = &(index->sections[index->sectionCount]);
+		if (index->is64bit) {
+			struct section_64 *sect = (struct section_64 *)section;
+			*info = (struct SDMSTSectionInfo){{0x0}, {0x0}, sect->addr, sect->size, sect->offset, sect->flags, sect->reserved1, sect->reserved2, index->segmentCount, section};
+		} else {
+			struct section *sect = (struct section *)section;
+			*info = (struct SDMSTSectionInfo){{0x0}, {0x0}, sect->addr, sect->size, sect->offset, sect->flags, sect->reserved1, sect->reserved2, index->segmentCount, section};
+		}
+		memcpy(info->sectname, ((struct section *)section)->sectname, sizeof(info->sectname));
+		memcpy(info->segname, ((struct section *)section)->segname, sizeof(info->segname));
+		index->sectionCount++;
+	}
+	index->segments = realloc(index->segments, sizeof(struct SDMSTSegmentInfo) * (index->segmentCount + 0x1));
+	index->segments[index->segmentCount] = segment;
+	index->segmentCount++;
+}
+
+void SDMSTCommandIndexNames(struct SDMSTCommandIndex *index) {
+	// Open addressing on segment and section names; the first segment or section with a given name is the one found.
+	uint32_t largest = (index->segmentCount > index->sectionCount ? index->segmentCount : index->sectionCount);
+	uint32_t slotCount = 0x2;
+	while (slotCount < largest * 0x2)
+		slotCount <<= 0x1;
+	index->nameSlotMask = slotCount - 0x1;
+	index->segmentSlots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+	index->sectionSlots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+	for (uint32_t i = 0x0; i < index->segmentCount; i++) {
+		if (SDMSTSegmentNamed(index, index->segments[i].name))
+			continue;
+		uint32_t slot = (uint32_t)SDMSTSegmentNameHash(index->segments[i].name) & index->nameSlotMask;
+		while (index->segmentSlots[slot])
+			slot = (slot + 0x1) & index->nameSlotMask;
+		index->segmentSlots[slot] = i + 0x1;
+	}
+	for (uint32_t i = 0x0; i < index->sectionCount; i++) {
+		if (SDMSTSectionNamed(index, index->sections[i].segname, index->sections[i].sectname))
+			continue;
+		uint32_t slot = (uint32_t)SDMSTSectionNameHash(index->sections[i].segname, index->sections[i].sectname) & index->nameSlotMask;
+		while (index->sectionSlots[slot])
+			slot = (slot + 0x1) & index->nameSlotMask;
+		index->sectionSlots[slot] = i + 0x1;
+	}
+}
+
+struct SDMSTCommandIndex* SDMSTCommandIndexCreate(struct mach_header *header, uint64_t size) {
+	// Bounds are checked once, here: every indexed command lies inside sizeofcmds and holds at least its fixed part, and
+	// every indexed section lies inside its segment command, so callers use what the index hands out directly. The
+	// header must already be in host order.
+	if (header == NULL || size < sizeof(struct mach_header) || (header->magic != MH_MAGIC && header->magic != MH_MAGIC_64))
+		return NULL;
+	bool is64bit = (header->magic == MH_MAGIC_64);
+	uint64_t headerSize = (is64bit ? sizeof(struct mach_header_64) : sizeof(struct mach_header));
+	if (size < headerSize || header->sizeofcmds > size - headerSize)
+		return NULL;
+	struct SDMSTCommandIndex *index = (struct SDMSTCommandIndex *)calloc(0x1, sizeof(struct SDMSTCommandIndex));
+	index->header = header;
+	index->is64bit = is64bit;
+	uint32_t capacity = header->ncmds;
+	if (capacity > header->sizeofcmds / sizeof(struct load_command))
+		capacity = header->sizeofcmds / (uint32_t)sizeof(struct load_command);
+	index->commands = (struct SDMSTLoadCommandEntry *)calloc(capacity + 0x1, sizeof(struct SDMSTLoadCommandEntry));
+	uint32_t tails[kSDMSTCommandSlotCount];
+	memset(tails, 0x0, sizeof(tails));
+	char *command = (char*)header + headerSize;
+	char *commandsEnd = command + header->sizeofcmds;
+	for (uint32_t i = 0x0; i < capacity && command + sizeof(struct load_command) <= commandsEnd; i++) {
+		struct load_command *loadCmd = (struct load_command *)command;
+		if (loadCmd->cmdsize < sizeof(struct load_command) || loadCmd->cmdsize > (uint64_t)(commandsEnd - command))
+			break;
+		if (loadCmd->cmdsize >= SDMSTCommandMinimumSize(loadCmd->cmd)) {
+			// Commands sharing a slot are chained in file order, so the first of a kind is found without a walk.
+			uint32_t slot = loadCmd->cmd & (kSDMSTCommandSlotCount - 0x1);
+			index->commands[index->commandCount] = (struct SDMSTLoadCommandEntry){loadCmd->cmd, loadCmd->cmdsize, loadCmd, 0x0};
+			index->commandCount++;
+			if (tails[slot])
+				index->commands[tails[slot] - 0x1].next = index->commandCount;
+			else
+				index->slots[slot] = index->commandCount;
+			tails[slot] = index->commandCount;
+			if (loadCmd->cmd == (is64bit ? LC_SEGMENT_64 : LC_SEGMENT))
+				SDMSTCommandIndexSegment(index, loadCmd);
+		}
+		command += loadCmd->cmdsize;
+	}
+	SDMSTCommandIndexNames(index);
+	return index;
+}
+
+struct SDMSTLoadCommandEntry* SDMSTCommandFind(struct SDMSTCommandIndex *index, uint32_t cmd) {
+	struct SDMSTLoadCommandEntry *found = NULL;
+	for (uint32_t entry = (index ? index->slots[cmd & (kSDMSTCommandSlotCount - 0x1)] : 0x0); entry && found == NULL; entry = index->commands[entry - 0x1].next) {
+		if (index->commands[entry - 0x1].cmd == cmd)
+			found = &(index->commands[entry - 0x1]);
+	}
+	return found;
+}
+
+struct SDMSTLoadCommandEntry* SDMSTCommandNext(struct SDMSTCommandIndex *index, struct SDMSTLoadCommandEntry *entry) {
+	struct SDMSTLoadCommandEntry *found = NULL;
+	for (uint32_t next = (index && entry ? entry->next : 0x0); next && found == NULL; next = index->commands[next - 0x1].next) {
+		if (index->commands[next - 0x1].cmd == entry->cmd)
+			found = &(index->commands[next - 0x1]);
+	}
+	return found;
+}
+
+const char* SDMSTCommandString(struct SDMSTLoadCommandEntry *entry, uint32_t offset) {
+	// lc_str offsets are relative to the command; the string must end inside it.
+	if (entry == NULL || offset < sizeof(struct load_command) || offset >= entry->size)
+		return NULL;
+	const char *string = (char*)entry->command + offset;
+	return (strnlen(string, entry->size - offset) < entry->size - offset ? string : NULL);
+}
+
+struct SDMSTSegmentInfo* SDMSTSegmentNamed(struct SDMSTCommandIndex *index, const char *segname) {
+	if (index == NULL || segname == NULL || index->segmentSlots == NULL)
+		return NULL;
+	for (uint32_t slot = (uint32_t)SDMSTSegmentNameHash(segname) & index->nameSlotMask; index->segmentSlots[slot]; slot = (slot + 0x1) & index->nameSlotMask) {
+		struct SDMSTSegmentInfo *segment = &(index->segments[index->segmentSlots[slot] - 0x1]);
+		if (!strncmp(segment->name, segname, sizeof(segment->name)))
+			return segment;
+	}
+	return NULL;
+}
+
+struct SDMSTSectionInfo* SDMSTSectionNamed(struct SDMSTCommandIndex *index, const char *segname, const char *sectname) {
+	if (index == NULL || segname == NULL || sectname == NULL || index->sectionSlots == NULL)
+		return NULL;
+	for (uint32_t slot = (uint32_t)SDMSTSectionNameHash(segname, sectname) & index->nameSlotMask; index->sectionSlots[slot]; slot = (slot + 0x1) & index->nameSlotMask) {
+		struct SDMSTSectionInfo *section = &(index->sections[index->sectionSlots[slot] - 0x1]);
+		if (!strncmp(section->segname, segname, sizeof(section->segname)) && !strncmp(section->sectname, sectname, sizeof(section->sectname)))
+			return section;
+	}
+	return NULL;
+}
+
+void SDMSTCommandIndexRelease(struct SDMSTCommandIndex *index) {
+	if (index) {
+		free(index->commands);
+		free(index->segments);
+		free(index->sections);
+		free(index->segmentSlots);
+		free(index->sectionSlots);
+		free(index);
+	}
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ *  SDMSTCommandIndex.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTCOMMANDINDEX_H_
+#define _SDMSTCOMMANDINDEX_H_
+
+#pragma mark -
+#pragma mark Includes
+#include <stdint.h>
+#include <stdbool.h>
+#include "SDMMachOTypes.h"
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTCommandSlotCount 0x40
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTLoadCommandEntry {
+	uint32_t cmd;
+	uint32_t size;
+	struct load_command *command;
+	uint32_t next;
+} SDMSTLoadCommandEntry;
+
+typedef struct SDMSTSegmentInfo {
+	char name[0x10];
+	uint64_t vmaddr;
+	uint64_t vmsize;
+	uint64_t fileoff;
+	uint64_t filesize;
+	uint32_t flags;
+	uint32_t firstSection;
+	uint32_t sectionCount;
+	struct load_command *command;
+} SDMSTSegmentInfo;
+
+typedef struct SDMSTSectionInfo {
+	char segname[0x10];
+	char sectname[0x10];
+	uint64_t address;
+	uint64_t size;
+	uint32_t offset;
+	uint32_t flags;
+	uint32_t reserved1;
+	uint32_t reserved2;
+	uint32_t segment;
+	void* section;
+} SDMSTSectionInfo;
+
+typedef struct SDMSTCommandIndex {
+	struct mach_header *header;
+	bool is64bit;
+	struct SDMSTLoadCommandEntry *commands;
+	uint32_t commandCount;
+	uint32_t slots[kSDMSTCommandSlotCount];
+	struct SDMSTSegmentInfo *segments;
+	uint32_t segmentCount;
+	struct SDMSTSectionInfo *sections;
+	uint32_t sectionCount;
+	uint32_t *segmentSlots;
+	uint32_t *sectionSlots;
+	uint32_t nameSlotMask;
+} SDMSTCommandIndex;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTCommandIndex* SDMSTCommandIndexCreate(struct mach_header *header, uint64_t size);
+struct SDMSTLoadCommandEntry* SDMSTCommandFind(struct SDMSTCommandIndex *index, uint32_t cmd);
+struct SDMSTLoadCommandEntry* SDMSTCommandNext(struct SDMSTCommandIndex *index, struct SDMSTLoadCommandEntry *entry);
+const char* SDMSTCommandString(struct SDMSTLoadCommandEntry *entry, uint32_t offset);
+struct SDMSTSegmentInfo* SDMSTSegmentNamed(struct SDMSTCommandIndex *index, const char *segname);
+struct SDMSTSectionInfo* SDMSTSectionNamed(struct SDMSTCommandIndex *index, const char *segname, const char *sectname);
+void SDMSTCommandIndexRelease(struct SDMSTCommandIndex *index);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ *  SDMSTExportTrie.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTEXPORTTRIE_C_
+#define _SDMSTEXPORTTRIE_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTExportTrie.h"
+#include "SDMSTString.h"
+#include "SDMMachO.h"
+#include <string.h>
+
+#pragma mark -
+#pragma mark Declarations
+
+bool SDMSTExportTrieReadTerminal(const uint8_t *cursor, const uint8_t *end, struct SDMSTExport *symbol);
+bool SDMSTExportTrieWalk(const uint8_t *trie, uint64_t size, uint64_t node, char *nameBuffer, uint32_t bufferSize, uint32_t nameLength, SDMSTExportCallback callback, void *context, uint32_t *count, uint64_t *budget);
+
+#pragma mark -
+#pragma mark Functions
+
+bool SDMSTExportTrieReadTerminal(const uint8_t *cursor, const uint8_t *end, struct SDMSTExport *symbol) {
+	uint64_t flags = 0x0, address = 0x0, resolver = 0x0, ordinal = 0x0;
+	const char *importName = NULL;
+	if (!SDMSTReadULEB128(&cursor, end, &flags))
+		return false;
+	if (flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
+		// A re-export names the dependent library by ordinal and, when it is renamed on the way, the name it has there.
+		if (!SDMSTReadULEB128(&cursor, end, &ordinal) || memchr(cursor, 0x0, (size_t)(end - cursor)) == NULL)
+			return false;
+		importName = (const char *)cursor;
+	} else {
+		if (!SDMSTReadULEB128(&cursor, end, &address))
+			return false;
+		if ((flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER) && !SDMSTReadULEB128(&cursor, end, &resolver))
+			return false;
+	}
+	*symbol = (struct SDMSTExport){NULL, flags, address, resolver, ordinal, importName};
+	return true;
+}
+
+bool SDMSTExportTrieLookup(const uint8_t *trie, uint64_t size, const char *prefix, const char *name, struct SDMSTExport *symbol) {
+	// The name is matched as prefix followed by name, so callers can add the C underscore without building a new string.
+	uint64_t prefixLength = (prefix ? SDMSTStringLength(prefix) : 0x0);
+	uint64_t length = prefixLength + SDMSTStringLength(name);
+	uint64_t matched = 0x0, node = 0x0;
+	const uint8_t *end = trie + size;
+	for (uint64_t steps = 0x0; trie && node < size && steps <= length; steps++) {
+		const uint8_t *cursor = trie + node;
+		uint64_t terminalSize;
+		if (!SDMSTReadULEB128(&cursor, end, &terminalSize) || terminalSize > (uint64_t)(end - cursor))
+			return false;
+		if (matched == length) {
+			if (terminalSize == 0x0 || !SDMSTExportTrieReadTerminal(cursor, cursor + terminalSize, symbol))
+				return false;
+			symbol->name = name;
+			return true;
+		}
+		cursor += terminalSize;
+		if (cursor >= end)
+			return false;
+		uint8_t childCount = *cursor++;
+		bool descended = false;
+		for (uint8_t i = 0x0; i < childCount && !descended; i++) {
+			uint64_t edge = 0x0;
+			bool matches = true;
+			for (; cursor < end && *cursor; cursor++, edge++) {
+				uint64_t position = matched + edge;
+				char expected = (position < prefixLength ? prefix[position] : (position < length ? name[position - prefixLength] : 0x0));
+				matches = (matches && position < length && (char)*cursor == expected);
+			}
+			uint64_t child;
+			if (cursor++ >= end || !SDMSTReadULEB128(&cursor, end, &child))
+				return false;
+			if (matches && edge) {
+				// Sibling edges never share a first character, so the first full match is the only possible path.
+				matched += edge;
+				node = child;
+				descended = true;
+			}
+		}
+		if (!descended)
+			return false;
+	}
+	return false;
+}
+
+bool SDMSTExportTrieWalk(const uint8_t *trie, uint64_t size, uint64_t node, char *nameBuffer, uint32_t bufferSize, uint32_t nameLength, SDMSTExportCallback callback, void *context, uint32_t *count, uint64_t *budget) {
+	const uint8_t *end = trie + size;
+	const uint8_t *cursor = trie + node;
+	uint64_t terminalSize;
+	// A well-formed trie is a tree of at most size nodes; the budget stops a malformed one whose edges loop back from
+	// being walked exponentially many times.
+	if (*budget == 0x0)
+		return false;
+	(*budget)--;
+	if (node >= size || !SDMSTReadULEB128(&cursor, end, &terminalSize) || terminalSize > (uint64_t)(end - cursor))
+		return true;
+	if (terminalSize) {
+		struct SDMSTExport symbol;
+		if (SDMSTExportTrieReadTerminal(cursor, cursor + terminalSize, &symbol)) {
+			nameBuffer[nameLength] = 0x0;
+			symbol.name = nameBuffer;
+			(*count)++;
+			if (callback && !callback(&symbol, context))
+				return false;
+		}
+	}
+	cursor += terminalSize;
+	if (cursor >= end)
+		return true;
+	uint8_t childCount = *cursor++;
+	for (uint8_t i = 0x0; i < childCount; i++) {
+		const char *edge = (const char *)cursor;
+		uint64_t edgeLength = 0x0;
+		while (cursor < end && *cursor) {
+			cursor++;
+			edgeLength++;
+		}
+		uint64_t child;
+		if (cursor++ >= end || !SDMSTReadULEB128(&cursor, end, &child))
+			return true;
+		// Every edge adds at least one character and the name must fit the caller's buffer, which bounds the recursion depth.
+		if (edgeLength && nameLength + edgeLength < bufferSize) {
+			memcpy(nameBuffer + nameLength, edge, (size_t)edgeLength);
+			if (!SDMSTExportTrieWalk(trie, size, child, nameBuffer, bufferSize, nameLength + (uint32_t)edgeLength, callback, context, count, budget))
+				return false;
+		}
+	}
+	return true;
+}
+
+uint32_t SDMSTExportTrieEnumerate(const uint8_t *trie, uint64_t size, char *nameBuffer, uint32_t bufferSize, SDMSTExportCallback callback, void *context) {
+	uint32_t count = 0x0;
+	uint64_t budget = size;
+	if (trie && size && nameBuffer && bufferSize)
+		SDMSTExportTrieWalk(trie, size, 0x0, nameBuffer, bufferSize, 0x0, callback, context, &count, &budget);
+	return count;
+}
+
+const uint8_t* SDMSTLibraryExportTrie(struct SDMMOLibrarySymbolTable *libTable, uint64_t *size) {
+	const uint8_t *trie = NULL;
+	if (libTable && libTable->libInfo && libTable->libInfo->exportSize) {
+		char *start = libTable->libInfo->linkeditBase + libTable->libInfo->exportOffset;
+		if (SDMSTMapLibraryRange(libTable, start, libTable->libInfo->exportSize, false)) {
+			trie = (const uint8_t *)start;
+			if (size)
+				*size = libTable->libInfo->exportSize;
+		}
+	}
+	return trie;
+}
+
+bool SDMSTExportLookup(struct SDMMOLibrarySymbolTable *libTable, const char *name, struct SDMSTExport *symbol) {
+	uint64_t size = 0x0;
+	const uint8_t *trie = SDMSTLibraryExportTrie(libTable, &size);
+	return (trie && name && (SDMSTExportTrieLookup(trie, size, NULL, name, symbol) || SDMSTExportTrieLookup(trie, size, "_", name, symbol)));
+}
+
+void* SDMSTExportAddress(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTExport *symbol) {
+	// Export addresses are offsets from the image's header, except absolute symbols; a re-export lives in another image.
+	if (symbol->flags & EXPORT_SYMBOL_FLAGS_REEXPORT)
+		return NULL;
+	if ((symbol->flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE)
+		return (void*)(uintptr_t)symbol->address;
+	return (char*)libTable->libInfo->mhOffset + symbol->address;
+}
+
+uint32_t SDMSTEnumerateExports(struct SDMMOLibrarySymbolTable *libTable, char *nameBuffer, uint32_t bufferSize, SDMSTExportCallback callback, void *context) {
+	uint64_t size = 0x0;
+	const uint8_t *trie = SDMSTLibraryExportTrie(libTable, &size);
+	return SDMSTExportTrieEnumerate(trie, size, nameBuffer, bufferSize, callback, context);
+}
+
+#endif
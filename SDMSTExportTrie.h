@@ -0,0 +1,50 @@
+/*
+ *  SDMSTExportTrie.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTEXPORTTRIE_H_
+#define _SDMSTEXPORTTRIE_H_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSymbolTable.h"
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTExport {
+	const char *name;
+	uint64_t flags;
+	uint64_t address;
+	uint64_t resolver;
+	uint64_t ordinal;
+	const char *importName;
+} __attribute__ ((packed)) SDMSTExport;
+
+typedef bool (*SDMSTExportCallback)(struct SDMSTExport *symbol, void *context);
+
+#pragma mark -
+#pragma mark Declarations
+
+bool SDMSTExportTrieLookup(const uint8_t *trie, uint64_t size, const char *prefix, const char *name, struct SDMSTExport *symbol);
+uint32_t SDMSTExportTrieEnumerate(const uint8_t *trie, uint64_t size, char *nameBuffer, uint32_t bufferSize, SDMSTExportCallback callback, void *context);
+const uint8_t* SDMSTLibraryExportTrie(struct SDMMOLibrarySymbolTable *libTable, uint64_t *size);
+bool SDMSTExportLookup(struct SDMMOLibrarySymbolTable *libTable, const char *name, struct SDMSTExport *symbol);
+void* SDMSTExportAddress(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTExport *symbol);
+uint32_t SDMSTEnumerateExports(struct SDMMOLibrarySymbolTable *libTable, char *nameBuffer, uint32_t bufferSize, SDMSTExportCallback callback, void *context);
+
+#endif
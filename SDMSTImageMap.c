@@ -0,0 +1,301 @@
+/*
+ *  SDMSTImageMap.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTIMAGEMAP_C_
+#define _SDMSTIMAGEMAP_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTImageMap.h"
+#include "SDMSTPerfectHash.h"
+#include "SDMSTString.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#ifdef __APPLE__
+#include <dlfcn.h>
+#include <mach-o/dyld.h>
+#endif
+
+#pragma mark -
+#pragma mark Declarations
+
+uint32_t SDMSTImageMapHeaderSlot(struct SDMSTImageMap *map, const void* header);
+uint32_t SDMSTImageMapPathSlot(struct SDMSTImageMap *map, const char *path, uint64_t length, uint64_t hash);
+uint32_t SDMSTImageMapHandleSlot(struct SDMSTImageMap *map, uintptr_t handle);
+void SDMSTImageMapGrow(struct SDMSTImageMap *map, uint32_t needed);
+void SDMSTImageMapAddKey(struct SDMSTImageMap *map, const char *path, uint32_t entry);
+void SDMSTImageMapAddLocked(struct SDMSTImageMap *map, const char *path, const struct mach_header *header, uint32_t imageIndex);
+int32_t SDMSTImageMapFindKey(struct SDMSTImageMap *map, const char *path);
+void SDMSTImageMapClear(struct SDMSTImageMap *map);
+void SDMSTImageMapRefreshLocked(struct SDMSTImageMap *map);
+void SDMSTImageMapCreateShared(void);
+#ifdef __APPLE__
+void SDMSTImageMapResolveHandlesLocked(struct SDMSTImageMap *map);
+void SDMSTImageMapImageRemoved(const struct mach_header *header, intptr_t slide);
+#endif
+
+static struct SDMSTImageMap *kSDMSTImageMapShared = NULL;
+static pthread_once_t kSDMSTImageMapSharedOnce = PTHREAD_ONCE_INIT;
+static uint32_t kSDMSTImageMapRemovals = 0x0;
+
+#pragma mark -
+#pragma mark Functions
+
+#ifdef __APPLE__
+void SDMSTImageMapImageRemoved(const struct mach_header *header, intptr_t slide) {
+	// dyld compacts its image list when an image goes away, so every cached index after it is stale; maps rebuild on their next use.
+	__atomic_fetch_add(&kSDMSTImageMapRemovals, 0x1, __ATOMIC_RELEASE);
+	(void)header;
+	(void)slide;
+}
+#endif
+
+void SDMSTImageMapCreateShared(void) {
+	kSDMSTImageMapShared = SDMSTImageMapCreate();
+#ifdef __APPLE__
+	_dyld_register_func_for_remove_image(SDMSTImageMapImageRemoved);
+#endif
+}
+
+struct SDMSTImageMap* SDMSTImageMapCreate(void) {
+	struct SDMSTImageMap *map = (struct SDMSTImageMap *)calloc(0x1, sizeof(struct SDMSTImageMap));
+	pthread_mutex_init(&(map->lock), NULL);
+	map->generation = __atomic_load_n(&kSDMSTImageMapRemovals, __ATOMIC_ACQUIRE);
+	SDMSTImageMapGrow(map, 0x40);
+	return map;
+}
+
+struct SDMSTImageMap* SDMSTImageMapShared(void) {
+	pthread_once(&kSDMSTImageMapSharedOnce, SDMSTImageMapCreateShared);
+	return kSDMSTImageMapShared;
+}
+
+uint32_t SDMSTImageMapHeaderSlot(struct SDMSTImageMap *map, const void* header) {
+	uint32_t mask = map->slotCount - 0x1;
+	uint32_t slot = (uint32_t)(((uint64_t)(uintptr_t)header * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+	while (map->headerSlots[slot] && map->entries[map->headerSlots[slot] - 0x1].header != header)
+		slot = (slot + 0x1) & mask;
+	return slot;
+}
+
+uint32_t SDMSTImageMapHandleSlot(struct SDMSTImageMap *map, uintptr_t handle) {
+	uint32_t mask = map->slotCount - 0x1;
+	uint32_t slot = (uint32_t)(((uint64_t)handle * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+	while (map->handleSlots[slot] && map->entries[map->handleSlots[slot] - 0x1].handle != handle)
+		slot = (slot + 0x1) & mask;
+	return slot;
+}
+
+uint32_t SDMSTImageMapPathSlot(struct SDMSTImageMap *map, const char *path, uint64_t length, uint64_t hash) {
+	uint32_t mask = map->slotCount - 0x1;
+	uint32_t slot = (uint32_t)hash & mask;
+	while (map->pathSlots[slot]) {
+		struct SDMSTImageKey *key = &(map->keys[map->pathSlots[slot] - 0x1]);
+		if (key->hash == hash && SDMSTStringLength(key->path) == length && SDMSTStringEqual(key->path, path, length))
+			break;
+		slot = (slot + 0x1) & mask;
+	}
+	return slot;
+}
+
+void SDMSTImageMapGrow(struct SDMSTImageMap *map, uint32_t needed) {
+	// All three tables stay under half full; they only ever index into entries/keys, so growing just rehashes the slots.
+	if (needed * 0x2 <= map->slotCount)
+		return;
+	uint32_t slotCount = (map->slotCount ? map->slotCount : 0x40);
+	while (needed * 0x2 > slotCount)
+		slotCount <<= 0x1;
+	free(map->pathSlots);
+	free(map->headerSlots);
+	free(map->handleSlots);
+	map->slotCount = slotCount;
+	map->pathSlots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+	map->headerSlots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+	map->handleSlots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+	for (uint32_t i = 0x0; i < map->keyCount; i++)
+		map->pathSlots[SDMSTImageMapPathSlot(map, map->keys[i].path, SDMSTStringLength(map->keys[i].path), map->keys[i].hash)] = i + 0x1;
+	for (uint32_t i = 0x0; i < map->entryCount; i++)
+		map->headerSlots[SDMSTImageMapHeaderSlot(map, map->entries[i].header)] = i + 0x1;
+	for (uint32_t i = 0x0; i < map->entryCount; i++)
+		if (map->entries[i].handle)
+			map->handleSlots[SDMSTImageMapHandleSlot(map, map->entries[i].handle)] = i + 0x1;
+}
+
+void SDMSTImageMapAddKey(struct SDMSTImageMap *map, const char *path, uint32_t entry) {
+	uint64_t length = SDMSTStringLength(path);
+	uint64_t hash = SDMSTHashName(path, length, 0x0);
+	uint32_t slot = SDMSTImageMapPathSlot(map, path, length, hash);
+	if (map->pathSlots[slot]) {
+		map->keys[map->pathSlots[slot] - 0x1].entry = entry;
+	} else {
+		SDMSTImageMapGrow(map, map->keyCount + 0x1);
+		slot = SDMSTImageMapPathSlot(map, path, length, hash);
+		map->keys = realloc(map->keys, sizeof(struct SDMSTImageKey) * (map->keyCount + 0x1));
+		map->keys[map->keyCount] = (struct SDMSTImageKey){hash, strdup(path), entry};
+		map->keyCount++;
+		map->pathSlots[slot] = map->keyCount;
+	}
+}
+
+void SDMSTImageMapAddLocked(struct SDMSTImageMap *map, const char *path, const struct mach_header *header, uint32_t imageIndex) {
+	SDMSTImageMapGrow(map, map->entryCount + 0x1);
+	uint32_t slot = SDMSTImageMapHeaderSlot(map, header);
+	uint32_t entry = map->entryCount;
+	if (map->headerSlots[slot]) {
+		entry = map->headerSlots[slot] - 0x1;
+		map->entries[entry].imageIndex = imageIndex;
+	} else {
+		map->entries = realloc(map->entries, sizeof(struct SDMSTImageEntry) * (map->entryCount + 0x1));
+		map->entries[entry] = (struct SDMSTImageEntry){header, imageIndex, 0x0};
+		map->entryCount++;
+		map->headerSlots[slot] = map->entryCount;
+	}
+	// Images are keyed by the name dyld reports and, when it differs, by its canonical path, so symlinked and relative
+	// spellings of either side meet on the same entry.
+	SDMSTImageMapAddKey(map, path, entry);
+	char resolved[PATH_MAX];
+	if (realpath(path, resolved) && strcmp(resolved, path))
+		SDMSTImageMapAddKey(map, resolved, entry);
+}
+
+void SDMSTImageMapAdd(struct SDMSTImageMap *map, const char *path, const struct mach_header *header, uint32_t imageIndex) {
+	pthread_mutex_lock(&(map->lock));
+	SDMSTImageMapAddLocked(map, path, header, imageIndex);
+	pthread_mutex_unlock(&(map->lock));
+}
+
+int32_t SDMSTImageMapFindKey(struct SDMSTImageMap *map, const char *path) {
+	uint64_t length = SDMSTStringLength(path);
+	uint32_t slot = SDMSTImageMapPathSlot(map, path, length, SDMSTHashName(path, length, 0x0));
+	return (map->pathSlots[slot] ? (int32_t)map->keys[map->pathSlots[slot] - 0x1].entry : -0x1);
+}
+
+void SDMSTImageMapClear(struct SDMSTImageMap *map) {
+	for (uint32_t i = 0x0; i < map->keyCount; i++)
+		free(map->keys[i].path);
+	free(map->keys);
+	free(map->entries);
+	map->keys = NULL;
+	map->entries = NULL;
+	map->keyCount = 0x0;
+	map->entryCount = 0x0;
+	map->scannedImages = 0x0;
+	map->handledKeys = 0x0;
+	memset(map->pathSlots, 0x0, sizeof(uint32_t) * map->slotCount);
+	memset(map->headerSlots, 0x0, sizeof(uint32_t) * map->slotCount);
+	memset(map->handleSlots, 0x0, sizeof(uint32_t) * map->slotCount);
+}
+
+void SDMSTImageMapRefreshLocked(struct SDMSTImageMap *map) {
+	uint32_t removals = __atomic_load_n(&kSDMSTImageMapRemovals, __ATOMIC_ACQUIRE);
+	if (removals != map->generation) {
+		SDMSTImageMapClear(map);
+		map->generation = removals;
+	}
+#ifdef __APPLE__
+	// Images are only ever appended between removals, so a refresh reads just the ones added since the last scan.
+	uint32_t count = _dyld_image_count();
+	for (uint32_t i = map->scannedImages; i < count; i++) {
+		const char *name = _dyld_get_image_name(i);
+		const struct mach_header *header = _dyld_get_image_header(i);
+		if (name && header)
+			SDMSTImageMapAddLocked(map, name, header, i);
+	}
+	map->scannedImages = count;
+#endif
+}
+
+#ifdef __APPLE__
+void SDMSTImageMapResolveHandlesLocked(struct SDMSTImageMap *map) {
+	// Each key is asked of dyld once, for entries that have no handle yet; dyld keeps the open mode in the low bits of a
+	// handle, so those are dropped before it is stored.
+	for (; map->handledKeys < map->keyCount; map->handledKeys++) {
+		struct SDMSTImageKey *key = &(map->keys[map->handledKeys]);
+		if (map->entries[key->entry].handle)
+			continue;
+		void* candidate = dlopen(key->path, RTLD_NOLOAD | RTLD_LOCAL);
+		if (candidate) {
+			map->entries[key->entry].handle = ((uintptr_t)candidate & ~(uintptr_t)0x3);
+			map->handleSlots[SDMSTImageMapHandleSlot(map, map->entries[key->entry].handle)] = key->entry + 0x1;
+			dlclose(candidate);
+		}
+	}
+}
+#endif
+
+void SDMSTImageMapRefresh(struct SDMSTImageMap *map) {
+	pthread_mutex_lock(&(map->lock));
+	SDMSTImageMapRefreshLocked(map);
+	pthread_mutex_unlock(&(map->lock));
+}
+
+bool SDMSTImageMapFindPath(struct SDMSTImageMap *map, const char *path, void* handle, struct SDMSTImageEntry *entry) {
+	pthread_mutex_lock(&(map->lock));
+	SDMSTImageMapRefreshLocked(map);
+	int32_t found = SDMSTImageMapFindKey(map, path);
+	if (found < 0x0) {
+		char resolved[PATH_MAX];
+		if (realpath(path, resolved))
+			found = SDMSTImageMapFindKey(map, resolved);
+	}
+#ifdef __APPLE__
+	if (found < 0x0 && handle) {
+		// Paths realpath cannot resolve (@rpath, @loader_path) are matched by dyld handle. Handles are looked up once per
+		// image and kept in their own table, so a lookup here is one probe after the first.
+		SDMSTImageMapResolveHandlesLocked(map);
+		uint32_t slot = SDMSTImageMapHandleSlot(map, ((uintptr_t)handle & ~(uintptr_t)0x3));
+		if (map->handleSlots[slot])
+			found = (int32_t)(map->handleSlots[slot] - 0x1);
+	}
+#else
+	(void)handle;
+#endif
+	if (found >= 0x0) {
+		// Remember the spelling that was asked for, so the next lookup of it is a single probe.
+		SDMSTImageMapAddKey(map, path, (uint32_t)found);
+		if (entry)
+			*entry = map->entries[found];
+	}
+	pthread_mutex_unlock(&(map->lock));
+	return (found >= 0x0);
+}
+
+bool SDMSTImageMapFindHeader(struct SDMSTImageMap *map, const void* header, struct SDMSTImageEntry *entry) {
+	pthread_mutex_lock(&(map->lock));
+	SDMSTImageMapRefreshLocked(map);
+	uint32_t slot = SDMSTImageMapHeaderSlot(map, header);
+	bool found = (map->headerSlots[slot] != 0x0);
+	if (found && entry)
+		*entry = map->entries[map->headerSlots[slot] - 0x1];
+	pthread_mutex_unlock(&(map->lock));
+	return found;
+}
+
+void SDMSTImageMapRelease(struct SDMSTImageMap *map) {
+	if (map) {
+		SDMSTImageMapClear(map);
+		free(map->pathSlots);
+		free(map->headerSlots);
+		free(map->handleSlots);
+		pthread_mutex_destroy(&(map->lock));
+		free(map);
+	}
+}
+
+#endif
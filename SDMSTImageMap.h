@@ -0,0 +1,70 @@
+/*
+ *  SDMSTImageMap.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTIMAGEMAP_H_
+#define _SDMSTIMAGEMAP_H_
+
+#pragma mark -
+#pragma mark Includes
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "SDMMachOTypes.h"
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTImageEntry {
+	const struct mach_header *header;
+	uint32_t imageIndex;
+	uintptr_t handle;
+} __attribute__ ((packed)) SDMSTImageEntry;
+
+typedef struct SDMSTImageKey {
+	uint64_t hash;
+	char *path;
+	uint32_t entry;
+} __attribute__ ((packed)) SDMSTImageKey;
+
+typedef struct SDMSTImageMap {
+	pthread_mutex_t lock;
+	struct SDMSTImageEntry *entries;
+	uint32_t entryCount;
+	struct SDMSTImageKey *keys;
+	uint32_t keyCount;
+	uint32_t *pathSlots;
+	uint32_t *headerSlots;
+	uint32_t *handleSlots;
+	uint32_t slotCount;
+	uint32_t handledKeys;
+	uint32_t scannedImages;
+	uint32_t generation;
+} SDMSTImageMap;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTImageMap* SDMSTImageMapCreate(void);
+struct SDMSTImageMap* SDMSTImageMapShared(void);
+void SDMSTImageMapAdd(struct SDMSTImageMap *map, const char *path, const struct mach_header *header, uint32_t imageIndex);
+void SDMSTImageMapRefresh(struct SDMSTImageMap *map);
+bool SDMSTImageMapFindPath(struct SDMSTImageMap *map, const char *path, void* handle, struct SDMSTImageEntry *entry);
+bool SDMSTImageMapFindHeader(struct SDMSTImageMap *map, const void* header, struct SDMSTImageEntry *entry);
+void SDMSTImageMapRelease(struct SDMSTImageMap *map);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ *  SDMSTIndexCache.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTINDEXCACHE_C_
+#define _SDMSTINDEXCACHE_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTIndexCache.h"
+#include "SDMMachO.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#pragma mark -
+#pragma mark Functions
+
+char* SDMSTIndexCachePath(const char *directory, const uint8_t *uuid, struct SDMSTLibraryArchitecture arch) {
+	// One file per (LC_UUID, slice): the UUID alone is shared by every slice of a universal binary.
+	uint64_t length = strlen(directory) + 0x60;
+	char *path = (char *)calloc(length, sizeof(char));
+	int written = snprintf(path, length, "%s/", directory);
+	for (uint32_t i = 0x0; i < 0x10; i++)
+		written += snprintf(path + written, length - (uint64_t)written, "%02X", uuid[i]);
+	snprintf(path + written, length - (uint64_t)written, "-%08x-%08x.%s", (uint32_t)arch.type, (uint32_t)arch.subtype, kSDMSTIndexCacheExtension);
+	return path;
+}
+
+bool SDMSTIndexCacheStore(struct SDMMOLibrarySymbolTable *libTable, const char *directory) {
+	// The image is built in a temporary file beside its final name and renamed over it, so readers only ever open a
+	// complete file; a crash mid-write leaves a stray temporary and never a torn cache entry.
+	bool stored = false;
+	uint8_t uuid[0x10];
+	if (directory == NULL || !SDMSTLibraryUUID(libTable, uuid))
+		return false;
+	uint64_t size = SDMSTIndexImageSize(libTable);
+	if (size == 0x0)
+		return false;
+	mkdir(directory, 0755);
+	char *path = SDMSTIndexCachePath(directory, uuid, libTable->libInfo->arch);
+	uint64_t temporaryLength = strlen(path) + 0x8;
+	char *temporaryPath = (char *)calloc(temporaryLength, sizeof(char));
+	snprintf(temporaryPath, temporaryLength, "%s.XXXXXX", path);
+	int fd = mkstemp(temporaryPath);
+	if (fd >= 0x0) {
+		if (fchmod(fd, 0644) == 0x0 && ftruncate(fd, (off_t)size) == 0x0) {
+			void *mapping = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0x0);
+			if (mapping != MAP_FAILED) {
+				if (SDMSTIndexImageWrite(libTable, mapping, size, 0x0)) {
+					SDMSTIndexImagePublish(mapping);
+					stored = (msync(mapping, (size_t)size, MS_SYNC) == 0x0);
+				}
+				munmap(mapping, (size_t)size);
+			}
+		}
+		close(fd);
+		if (stored)
+			stored = (rename(temporaryPath, path) == 0x0);
+		if (!stored)
+			unlink(temporaryPath);
+	}
+	free(temporaryPath);
+	free(path);
+	return stored;
+}
+
+bool SDMSTIndexCacheLoad(struct SDMMOLibrarySymbolTable *libTable, const char *directory) {
+	// A hit replaces symbol table generation entirely: only the load commands have been read, and the table, names and
+	// perfect hash are used straight out of the mapped cache file.
+	bool loaded = false;
+	uint8_t uuid[0x10];
+	if (directory == NULL || libTable->table || libTable->libInfo == NULL || libTable->libInfo->textSeg == NULL || !SDMSTLibraryUUID(libTable, uuid))
+		return false;
+	char *path = SDMSTIndexCachePath(directory, uuid, libTable->libInfo->arch);
+	int fd = open(path, O_RDONLY);
+	free(path);
+	if (fd < 0x0)
+		return false;
+	struct stat fs;
+	if (fstat(fd, &fs) == 0x0 && fs.st_size >= (off_t)sizeof(struct SDMSTIndexImageHeader)) {
+		void *mapping = mmap(NULL, (size_t)fs.st_size, PROT_READ, MAP_PRIVATE, fd, 0x0);
+		struct SDMSTIndexImage *image = (mapping != MAP_FAILED ? SDMSTIndexImageCreateFromBuffer(mapping, (uint64_t)fs.st_size, true) : NULL);
+		struct SDMSTSeg64Data textData = SDMSTSegmentData(libTable->libInfo->textSeg, libTable->libInfo->is64bit);
+		if (image && !memcmp(image->header->uuid, uuid, sizeof(uuid)) && image->header->arch.type == libTable->libInfo->arch.type && image->header->arch.subtype == libTable->libInfo->arch.subtype && image->header->textAddress == textData.vmaddr && image->header->textSize == textData.vmsize) {
+			uint32_t count = image->header->symbolCount;
+			libTable->table = (struct SDMSTMachOSymbol *)calloc(count + 0x1, sizeof(struct SDMSTMachOSymbol));
+			for (uint32_t i = 0x0; i < count; i++) {
+				struct SDMSTIndexImageSymbol *symbol = &(image->symbols[i]);
+				libTable->table[i].tableNumber = symbol->tableNumber;
+				libTable->table[i].symbolNumber = symbol->symbolNumber;
+				libTable->table[i].offset = (void*)((uintptr_t)image->addresses[i] + libTable->libInfo->vmSlide);
+				libTable->table[i].name = image->strings + symbol->nameOffset;
+				libTable->table[i].nameLength = symbol->nameLength;
+				libTable->table[i].isStub = (symbol->isStub != 0x0);
+			}
+			libTable->symbolCount = count;
+			libTable->functionStarts = (uintptr_t *)calloc(image->header->functionStartCount + 0x1, sizeof(uintptr_t));
+			for (uint32_t i = 0x0; i < image->header->functionStartCount; i++)
+				libTable->functionStarts[i] = (uintptr_t)image->functionStarts[i] + libTable->libInfo->vmSlide;
+			libTable->functionStartCount = image->header->functionStartCount;
+			// The perfect hash reads from the mapping, which now lives as long as the table does.
+			libTable->nameIndex = image->nameIndex;
+			image->nameIndex = NULL;
+			libTable->cacheBase = mapping;
+			libTable->cacheSize = (uint64_t)fs.st_size;
+			loaded = true;
+		}
+		SDMSTIndexImageRelease(image);
+		if (!loaded && mapping != MAP_FAILED)
+			munmap(mapping, (size_t)fs.st_size);
+	}
+	close(fd);
+	return loaded;
+}
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ *  SDMSTIndexImage.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTINDEXIMAGE_C_
+#define _SDMSTINDEXIMAGE_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTIndexImage.h"
+#include "SDMSTString.h"
+#include "SDMMachO.h"
+#include <string.h>
+
+#pragma mark -
+#pragma mark Declarations
+
+uint64_t SDMSTIndexImageAlign(uint64_t value);
+uint64_t SDMSTIndexImageLayout(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTIndexImageHeader *header);
+bool SDMSTIndexImageRegionValid(struct SDMSTIndexImageHeader *header, uint64_t offset, uint64_t length);
+uint64_t SDMSTIndexImageRangeEnd(struct SDMSTIndexImage *image, uint64_t address);
+
+#pragma mark -
+#pragma mark Functions
+
+uint64_t SDMSTIndexImageAlign(uint64_t value) {
+	return (value + (kSDMSTIndexImageAlignment - 0x1)) & ~(uint64_t)(kSDMSTIndexImageAlignment - 0x1);
+}
+
+uint64_t SDMSTIndexImageLayout(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTIndexImageHeader *header) {
+	memset(header, 0x0, sizeof(struct SDMSTIndexImageHeader));
+	header->magic = kSDMSTIndexImageMagic;
+	header->version = kSDMSTIndexImageVersion;
+	header->state = kSDMSTIndexImageStateBuilding;
+	header->headerSize = sizeof(struct SDMSTIndexImageHeader);
+	header->symbolCount = libTable->symbolCount;
+	header->functionStartCount = libTable->functionStartCount;
+	header->rangeCount = (libTable->addressIndex ? libTable->addressIndex->rangeCount : 0x0);
+	for (uint32_t i = 0x0; i < libTable->symbolCount; i++)
+		header->stringsSize += libTable->table[i].nameLength + 0x1;
+	header->nameIndexSize = SDMSTPerfectHashSerializedSize(libTable->nameIndex);
+	header->addressesOffset = SDMSTIndexImageAlign(sizeof(struct SDMSTIndexImageHeader));
+	header->symbolsOffset = SDMSTIndexImageAlign(header->addressesOffset + (uint64_t)header->symbolCount * sizeof(uint64_t));
+	header->stringsOffset = SDMSTIndexImageAlign(header->symbolsOffset + (uint64_t)header->symbolCount * sizeof(struct SDMSTIndexImageSymbol));
+	header->nameIndexOffset = SDMSTIndexImageAlign(header->stringsOffset + header->stringsSize);
+	header->functionStartsOffset = SDMSTIndexImageAlign(header->nameIndexOffset + header->nameIndexSize);
+	header->rangesOffset = SDMSTIndexImageAlign(header->functionStartsOffset + (uint64_t)header->functionStartCount * sizeof(uint64_t));
+	header->totalSize = SDMSTIndexImageAlign(header->rangesOffset + header->rangeCount * sizeof(struct SDMSTIndexImageRange));
+	return header->totalSize;
+}
+
+uint64_t SDMSTIndexImageSize(struct SDMMOLibrarySymbolTable *libTable) {
+	uint64_t size = 0x0;
+	if (libTable && libTable->libInfo && libTable->table && SDMSTBuildNameIndex(libTable, 0x0)) {
+		struct SDMSTIndexImageHeader header;
+		size = SDMSTIndexImageLayout(libTable, &header);
+	}
+	return size;
+}
+
+bool SDMSTIndexImageWrite(struct SDMMOLibrarySymbolTable *libTable, void *buffer, uint64_t size, uint64_t generation) {
+	// Leaves the image in the building state; SDMSTIndexImagePublish flips it once every byte is in place.
+	uint64_t imageSize = SDMSTIndexImageSize(libTable);
+	if (imageSize == 0x0 || buffer == NULL || size < imageSize)
+		return false;
+	struct SDMSTIndexImageHeader *header = (struct SDMSTIndexImageHeader *)buffer;
+	SDMSTIndexImageLayout(libTable, header);
+	header->generation = generation;
+	header->arch = libTable->libInfo->arch;
+	SDMSTLibraryUUID(libTable, header->uuid);
+	if (libTable->libInfo->textSeg) {
+		struct SDMSTSeg64Data textData = SDMSTSegmentData(libTable->libInfo->textSeg, libTable->libInfo->is64bit);
+		header->textAddress = textData.vmaddr;
+		header->textSize = textData.vmsize;
+	}
+	uint64_t *addresses = (uint64_t *)((char *)buffer + header->addressesOffset);
+	struct SDMSTIndexImageSymbol *symbols = (struct SDMSTIndexImageSymbol *)((char *)buffer + header->symbolsOffset);
+	char *strings = (char *)buffer + header->stringsOffset;
+	uint64_t stringOffset = 0x0;
+	for (uint32_t i = 0x0; i < libTable->symbolCount; i++) {
+		struct SDMSTMachOSymbol *symbol = &(libTable->table[i]);
+		addresses[i] = (uint64_t)((uintptr_t)symbol->offset - libTable->libInfo->vmSlide);
+		symbols[i] = (struct SDMSTIndexImageSymbol){stringOffset, symbol->nameLength, symbol->tableNumber, symbol->symbolNumber, (symbol->isStub ? 0x1 : 0x0)};
+		memcpy(strings + stringOffset, symbol->name, symbol->nameLength);
+		strings[stringOffset + symbol->nameLength] = '\0';
+		stringOffset += symbol->nameLength + 0x1;
+	}
+	SDMSTPerfectHashSerialize(libTable->nameIndex, (char *)buffer + header->nameIndexOffset);
+	uint64_t *functionStarts = (uint64_t *)((char *)buffer + header->functionStartsOffset);
+	for (uint32_t i = 0x0; i < libTable->functionStartCount; i++)
+		functionStarts[i] = (uint64_t)(libTable->functionStarts[i] - libTable->libInfo->vmSlide);
+	struct SDMSTIndexImageRange *ranges = (struct SDMSTIndexImageRange *)((char *)buffer + header->rangesOffset);
+	for (uint64_t i = 0x0; i < header->rangeCount; i++) {
+		struct SDMSTAddressRange *range = &(libTable->addressIndex->ranges[i]);
+		ranges[i] = (struct SDMSTIndexImageRange){(uint64_t)(range->start - libTable->libInfo->vmSlide), (uint64_t)(range->end - libTable->libInfo->vmSlide)};
+	}
+	header->checksum = SDMSTHashName((char *)buffer + header->headerSize, header->totalSize - header->headerSize, kSDMSTIndexImageChecksumSeed);
+	return true;
+}
+
+void SDMSTIndexImagePublish(void *buffer) {
+	struct SDMSTIndexImageHeader *header = (struct SDMSTIndexImageHeader *)buffer;
+	__atomic_store_n(&header->state, kSDMSTIndexImageStatePublished, __ATOMIC_RELEASE);
+}
+
+bool SDMSTIndexImageRegionValid(struct SDMSTIndexImageHeader *header, uint64_t offset, uint64_t length) {
+	return (offset % kSDMSTIndexImageAlignment == 0x0 && offset <= header->totalSize && length <= header->totalSize - offset);
+}
+
+struct SDMSTIndexImage* SDMSTIndexImageCreateFromBuffer(void *buffer, uint64_t size, bool verifyChecksum) {
+	struct SDMSTIndexImage *image = NULL;
+	struct SDMSTIndexImageHeader *header = (struct SDMSTIndexImageHeader *)buffer;
+	if (buffer == NULL || size < sizeof(struct SDMSTIndexImageHeader))
+		return NULL;
+	// The acquire pairs with the publisher's release, so a published flag guarantees the rest of the image is visible.
+	if (__atomic_load_n(&header->state, __ATOMIC_ACQUIRE) != kSDMSTIndexImageStatePublished)
+		return NULL;
+	if (header->magic != kSDMSTIndexImageMagic || header->version != kSDMSTIndexImageVersion || header->headerSize != sizeof(struct SDMSTIndexImageHeader) || header->totalSize > size || header->totalSize < header->headerSize)
+		return NULL;
+	if (!SDMSTIndexImageRegionValid(header, header->addressesOffset, (uint64_t)header->symbolCount * sizeof(uint64_t)) ||
+		!SDMSTIndexImageRegionValid(header, header->symbolsOffset, (uint64_t)header->symbolCount * sizeof(struct SDMSTIndexImageSymbol)) ||
+		!SDMSTIndexImageRegionValid(header, header->stringsOffset, header->stringsSize) ||
+		!SDMSTIndexImageRegionValid(header, header->nameIndexOffset, header->nameIndexSize) ||
+		!SDMSTIndexImageRegionValid(header, header->functionStartsOffset, (uint64_t)header->functionStartCount * sizeof(uint64_t)) ||
+		header->rangeCount > header->totalSize / sizeof(struct SDMSTIndexImageRange) ||
+		!SDMSTIndexImageRegionValid(header, header->rangesOffset, header->rangeCount * sizeof(struct SDMSTIndexImageRange)))
+		return NULL;
+	// Hashing the body is linear in the image, so it is left to callers that read files which may be torn or altered on disk;
+	// attaching to an image another process has published stays constant time.
+	if (verifyChecksum && header->checksum != SDMSTHashName((char *)buffer + header->headerSize, header->totalSize - header->headerSize, kSDMSTIndexImageChecksumSeed))
+		return NULL;
+	if (header->stringsSize && ((char *)buffer)[header->stringsOffset + header->stringsSize - 0x1] != '\0')
+		return NULL;
+	struct SDMSTPerfectHash *nameIndex = SDMSTPerfectHashCreateFromBuffer((char *)buffer + header->nameIndexOffset, header->nameIndexSize);
+	if (nameIndex) {
+		image = (struct SDMSTIndexImage *)calloc(0x1, sizeof(struct SDMSTIndexImage));
+		image->base = buffer;
+		image->size = size;
+		image->header = header;
+		image->addresses = (uint64_t *)((char *)buffer + header->addressesOffset);
+		image->symbols = (struct SDMSTIndexImageSymbol *)((char *)buffer + header->symbolsOffset);
+		image->strings = (char *)buffer + header->stringsOffset;
+		image->nameIndex = nameIndex;
+		image->functionStarts = (uint64_t *)((char *)buffer + header->functionStartsOffset);
+		image->ranges = (struct SDMSTIndexImageRange *)((char *)buffer + header->rangesOffset);
+	}
+	return image;
+}
+
+const char* SDMSTIndexImageSymbolName(struct SDMSTIndexImage *image, uint32_t symbol) {
+	const char *name = NULL;
+	if (image && symbol < image->header->symbolCount) {
+		struct SDMSTIndexImageSymbol *entry = &(image->symbols[symbol]);
+		if (entry->nameOffset < image->header->stringsSize && entry->nameLength < image->header->stringsSize - entry->nameOffset)
+			name = image->strings + entry->nameOffset;
+	}
+	return name;
+}
+
+uint32_t SDMSTIndexImageLookupName(struct SDMSTIndexImage *image, const char *name) {
+	// Same matching as SDMSTNameIndexLookup: the exact name first, then the C-mangled "_" form.
+	uint32_t result = kSDMSTIndexImageNotFound;
+	if (image && name) {
+		uint64_t length = SDMSTStringLength(name);
+		char *prefixedName = (char *)calloc(length + 0x2, sizeof(char));
+		prefixedName[0x0] = '_';
+		memcpy(&prefixedName[0x1], name, length);
+		const char *candidates[0x2] = {name, prefixedName};
+		for (uint32_t i = 0x0; i < 0x2 && result == kSDMSTIndexImageNotFound; i++) {
+			uint64_t candidateLength = length + i;
+			uint32_t index = SDMSTPerfectHashLookup(image->nameIndex, candidates[i], candidateLength);
+			const char *symbolName = SDMSTIndexImageSymbolName(image, index);
+			if (symbolName && image->symbols[index].nameLength == candidateLength && SDMSTStringEqual(symbolName, candidates[i], candidateLength))
+				result = index;
+		}
+		free(prefixedName);
+	}
+	return result;
+}
+
+uint64_t SDMSTIndexImageRangeEnd(struct SDMSTIndexImage *image, uint64_t address) {
+	if (image->header->rangeCount == 0x0)
+		return UINT64_MAX;
+	uint64_t low = 0x0, high = image->header->rangeCount;
+	while (low < high) {
+		uint64_t middle = low + ((high - low) >> 1);
+		if (image->ranges[middle].start <= address)
+			low = middle + 0x1;
+		else
+			high = middle;
+	}
+	return (low && address < image->ranges[low - 0x1].end ? image->ranges[low - 0x1].end : address);
+}
+
+uint32_t SDMSTIndexImageSymbolForAddress(struct SDMSTIndexImage *image, uint64_t address, uint64_t *offsetIntoSymbol) {
+	uint32_t result = kSDMSTIndexImageNotFound;
+	if (image && image->header->symbolCount) {
+		const uint64_t *base = image->addresses;
+		uint32_t length = image->header->symbolCount;
+		while (length > 0x1) {
+			uint32_t half = length >> 1;
+			base = ((base[half] <= address) ? &base[half] : base);
+			length -= half;
+		}
+		// Same extent rule as SDMSTAddressIndexCovers: past its own address a symbol reaches only the end of its range.
+		if (*base <= address && (*base == address || address < SDMSTIndexImageRangeEnd(image, *base))) {
+			result = (uint32_t)(base - image->addresses);
+			if (offsetIntoSymbol)
+				*offsetIntoSymbol = address - *base;
+		}
+	}
+	return result;
+}
+
+void SDMSTIndexImageRelease(struct SDMSTIndexImage *image) {
+	if (image) {
+		SDMSTPerfectHashRelease(image->nameIndex);
+		free(image);
+	}
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ *  SDMSTIndexImage.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTINDEXIMAGE_H_
+#define _SDMSTINDEXIMAGE_H_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSymbolTable.h"
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTIndexImageMagic 0x58444953
+#define kSDMSTIndexImageVersion 0x3
+#define kSDMSTIndexImageAlignment 0x8
+#define kSDMSTIndexImageStateBuilding 0x0
+#define kSDMSTIndexImageStatePublished 0x1
+#define kSDMSTIndexImageNotFound 0xffffffff
+#define kSDMSTIndexImageChecksumSeed 0x5344495358444953
+
+#pragma mark -
+#pragma mark Types
+
+// Flat, position-independent symbol index: every reference is a byte offset from the header, so the image can be mapped at any address.
+// Layout, each part 8-byte aligned: header, addresses (uint64_t per symbol, ascending, unslid), symbols, NUL-terminated string pool, perfect hash,
+// function starts (uint64_t, ascending, unslid), symbol ranges (unslid start/end pairs, ascending). The checksum covers everything
+// after the header and is only checked when asked for.
+typedef struct SDMSTIndexImageHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t state;
+	uint32_t headerSize;
+	uint64_t totalSize;
+	uint64_t generation;
+	uint8_t uuid[0x10];
+	struct SDMSTLibraryArchitecture arch;
+	uint64_t textAddress;
+	uint64_t textSize;
+	uint32_t symbolCount;
+	uint32_t functionStartCount;
+	uint64_t checksum;
+	uint64_t addressesOffset;
+	uint64_t symbolsOffset;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+	uint64_t nameIndexOffset;
+	uint64_t nameIndexSize;
+	uint64_t functionStartsOffset;
+	uint64_t rangesOffset;
+	uint64_t rangeCount;
+} __attribute__ ((packed)) SDMSTIndexImageHeader;
+
+typedef struct SDMSTIndexImageSymbol {
+	uint64_t nameOffset;
+	uint32_t nameLength;
+	uint32_t tableNumber;
+	uint32_t symbolNumber;
+	uint32_t isStub;
+} __attribute__ ((packed)) SDMSTIndexImageSymbol;
+
+typedef struct SDMSTIndexImageRange {
+	uint64_t start;
+	uint64_t end;
+} __attribute__ ((packed)) SDMSTIndexImageRange;
+
+typedef struct SDMSTIndexImage {
+	void *base;
+	uint64_t size;
+	struct SDMSTIndexImageHeader *header;
+	uint64_t *addresses;
+	struct SDMSTIndexImageSymbol *symbols;
+	char *strings;
+	struct SDMSTPerfectHash *nameIndex;
+	uint64_t *functionStarts;
+	struct SDMSTIndexImageRange *ranges;
+} SDMSTIndexImage;
+
+#pragma mark -
+#pragma mark Declarations
+
+uint64_t SDMSTIndexImageSize(struct SDMMOLibrarySymbolTable *libTable);
+bool SDMSTIndexImageWrite(struct SDMMOLibrarySymbolTable *libTable, void *buffer, uint64_t size, uint64_t generation);
+void SDMSTIndexImagePublish(void *buffer);
+struct SDMSTIndexImage* SDMSTIndexImageCreateFromBuffer(void *buffer, uint64_t size, bool verifyChecksum);
+uint32_t SDMSTIndexImageLookupName(struct SDMSTIndexImage *image, const char *name);
+uint32_t SDMSTIndexImageSymbolForAddress(struct SDMSTIndexImage *image, uint64_t address, uint64_t *offsetIntoSymbol);
+const char* SDMSTIndexImageSymbolName(struct SDMSTIndexImage *image, uint32_t symbol);
+void SDMSTIndexImageRelease(struct SDMSTIndexImage *image);
+
+#endif
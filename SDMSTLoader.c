@@ -0,0 +1,319 @@
+/*
+ *  SDMSTLoader.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTLOADER_C_
+#define _SDMSTLOADER_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTLoader.h"
+#include "SDMSTPerfectHash.h"
+#include "SDMSTString.h"
+#include "SDMSTCommandIndex.h"
+#include "SDMSTWorkers.h"
+#include <string.h>
+#include <limits.h>
+#include <stdio.h>
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTRunPathPrefix "@rpath/"
+#define kSDMSTLoaderPathPrefix "@loader_path"
+#define kSDMSTExecutablePathPrefix "@executable_path"
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTLoadBatch {
+	char **paths;
+	uint32_t count;
+	struct SDMSTLoadOptions *options;
+	struct SDMSTLoadResult *results;
+	uint32_t next;
+	uint32_t loaded;
+} SDMSTLoadBatch;
+
+#pragma mark -
+#pragma mark Declarations
+
+void* SDMSTLoadBatchWorker(void *context);
+uint32_t SDMSTLoadCommandStrings(struct SDMMOLibrarySymbolTable *libTable, bool runPaths, struct SDMSTDependency **strings);
+char* SDMSTExpandLoaderPath(const char *name, const char *loaderPath, const char *executablePath);
+char* SDMSTResolveInstallName(struct SDMSTLibraryRegistry *registry, uint32_t loader, const char *name);
+uint32_t SDMSTRegistrySlot(struct SDMSTLibraryRegistry *registry, const char *path);
+uint32_t SDMSTRegistryAdd(struct SDMSTLibraryRegistry *registry, char *path, const char *installName, uint32_t kind, uint32_t loader, bool resolved);
+
+#pragma mark -
+#pragma mark Functions
+
+void* SDMSTLoadBatchWorker(void *context) {
+	struct SDMSTLoadBatch *batch = (struct SDMSTLoadBatch *)context;
+	for (uint32_t index = __atomic_fetch_add(&batch->next, 0x1, __ATOMIC_RELAXED); index < batch->count; index = __atomic_fetch_add(&batch->next, 0x1, __ATOMIC_RELAXED)) {
+		struct SDMMOLibrarySymbolTable *table = SDMSTLoadLibraryWithOptions(batch->paths[index], batch->options);
+		batch->results[index].status = table->loadStatus;
+		if (table->loadStatus == kSDMSTLoadOK) {
+			batch->results[index].table = table;
+			__atomic_fetch_add(&batch->loaded, 0x1, __ATOMIC_RELAXED);
+		} else {
+			batch->results[index].table = NULL;
+			SDMSTLibraryRelease(table);
+		}
+	}
+	return NULL;
+}
+
+uint32_t SDMSTLoadLibraries(char **paths, uint32_t count, struct SDMSTLoadOptions *options, struct SDMSTLoadResult *results) {
+	struct SDMSTLoadBatch batch = {paths, count, options, results, 0x0, 0x0};
+	uint32_t threadCount = (options ? options->threadCount : 0x0);
+	if (threadCount == 0x0) {
+		// Each load alternates between blocking file I/O and parsing/sorting, so twice the core count keeps the cores busy
+		// while other workers wait on the disk.
+		threadCount = SDMSTOnlineProcessors() * 0x2;
+	}
+	SDMSTRunWorkers(threadCount, count, SDMSTLoadBatchWorker, &batch);
+	return batch.loaded;
+}
+
+uint32_t SDMSTLoadCommandStrings(struct SDMMOLibrarySymbolTable *libTable, bool runPaths, struct SDMSTDependency **strings) {
+	// Names point into the image's load commands and stay valid for as long as the table is loaded.
+	uint32_t count = 0x0;
+	*strings = NULL;
+	struct SDMSTCommandIndex *index = (libTable && libTable->libInfo ? libTable->libInfo->commandIndex : NULL);
+	if (index) {
+		*strings = (struct SDMSTDependency *)calloc(index->commandCount + 0x1, sizeof(struct SDMSTDependency));
+		for (uint32_t i = 0x0; i < index->commandCount; i++) {
+			struct load_command *loadCmd = index->commands[i].command;
+			uint32_t nameOffset = 0x0, kind = kSDMSTDependencyLoad;
+			if (runPaths) {
+				if (loadCmd->cmd == LC_RPATH)
+					nameOffset = ((struct rpath_command *)loadCmd)->path.offset;
+			} else {
+				switch (loadCmd->cmd) {
+					case LC_LOAD_DYLIB: {
+						kind = kSDMSTDependencyLoad;
+						break;
+					};
+					case LC_LOAD_WEAK_DYLIB: {
+						kind = kSDMSTDependencyWeak;
+						break;
+					};
+					case LC_REEXPORT_DYLIB: {
+						kind = kSDMSTDependencyReexport;
+						break;
+					};
+					case LC_LOAD_UPWARD_DYLIB: {
+						kind = kSDMSTDependencyUpward;
+						break;
+					};
+					case LC_LAZY_LOAD_DYLIB: {
+						kind = kSDMSTDependencyLazy;
+						break;
+					};
+					default: {
+						kind = UINT32_MAX;
+						break;
+					};
+				}
+				if (kind != UINT32_MAX)
+					nameOffset = ((struct dylib_command *)loadCmd)->dylib.name.offset;
+			}
+			const char *name = (nameOffset ? SDMSTCommandString(&(index->commands[i]), nameOffset) : NULL);
+			if (name)
+				(*strings)[count++] = (struct SDMSTDependency){name, kind};
+		}
+	}
+	return count;
+}
+
+uint32_t SDMSTLibraryDependencies(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTDependency **dependencies) {
+	return SDMSTLoadCommandStrings(libTable, false, dependencies);
+}
+
+char* SDMSTExpandLoaderPath(const char *name, const char *loaderPath, const char *executablePath) {
+	const char *base = NULL, *rest = name;
+	if (!strncmp(name, kSDMSTLoaderPathPrefix, strlen(kSDMSTLoaderPathPrefix))) {
+		base = loaderPath;
+		rest = name + strlen(kSDMSTLoaderPathPrefix);
+	} else if (!strncmp(name, kSDMSTExecutablePathPrefix, strlen(kSDMSTExecutablePathPrefix))) {
+		base = executablePath;
+		rest = name + strlen(kSDMSTExecutablePathPrefix);
+	}
+	if (base == NULL)
+		return strdup(name);
+	const char *slash = strrchr(base, '/');
+	int directoryLength = (slash ? (int)(slash - base) : 0x1);
+	const char *directory = (slash ? base : ".");
+	uint64_t length = (uint64_t)directoryLength + strlen(rest) + 0x1;
+	char *path = calloc(length, sizeof(char));
+	snprintf(path, length, "%.*s%s", directoryLength, directory, rest);
+	return path;
+}
+
+char* SDMSTResolveInstallName(struct SDMSTLibraryRegistry *registry, uint32_t loader, const char *name) {
+	// @rpath is searched through the LC_RPATH entries of the loading image and then each image that loaded it, the same
+	// order dyld uses; any other name only needs its @loader_path or @executable_path prefix expanded.
+	char *resolved = NULL;
+	char canonical[PATH_MAX];
+	const char *executablePath = registry->entries[0x0].path;
+	if (!strncmp(name, kSDMSTRunPathPrefix, strlen(kSDMSTRunPathPrefix))) {
+		const char *rest = name + strlen(kSDMSTRunPathPrefix) - 0x1;
+		uint32_t image = loader;
+		for (uint32_t depth = 0x0; resolved == NULL && depth < registry->count; depth++) {
+			struct SDMSTDependency *runPaths = NULL;
+			uint32_t runPathCount = SDMSTLoadCommandStrings(registry->entries[image].table, true, &runPaths);
+			for (uint32_t i = 0x0; resolved == NULL && i < runPathCount; i++) {
+				char *runPath = SDMSTExpandLoaderPath(runPaths[i].name, registry->entries[image].path, executablePath);
+				uint64_t length = strlen(runPath) + strlen(rest) + 0x1;
+				char *candidate = calloc(length, sizeof(char));
+				snprintf(candidate, length, "%s%s", runPath, rest);
+				if (realpath(candidate, canonical))
+					resolved = strdup(canonical);
+				free(candidate);
+				free(runPath);
+			}
+			free(runPaths);
+			if (image == registry->entries[image].loader)
+				break;
+			image = registry->entries[image].loader;
+		}
+	} else {
+		char *expanded = SDMSTExpandLoaderPath(name, registry->entries[loader].path, executablePath);
+		// Libraries that only exist inside the dyld shared cache have no file to canonicalize; keep the install name.
+		if (realpath(expanded, canonical)) {
+			resolved = strdup(canonical);
+			free(expanded);
+		} else {
+			resolved = expanded;
+		}
+	}
+	return resolved;
+}
+
+uint32_t SDMSTRegistrySlot(struct SDMSTLibraryRegistry *registry, const char *path) {
+	uint64_t length = SDMSTStringLength(path);
+	uint32_t mask = registry->slotCount - 0x1;
+	uint32_t slot = (uint32_t)SDMSTHashName(path, length, 0x0) & mask;
+	while (registry->slots[slot]) {
+		char *entryPath = registry->entries[registry->slots[slot] - 0x1].path;
+		if (SDMSTStringLength(entryPath) == length && SDMSTStringEqual(entryPath, path, length))
+			break;
+		slot = (slot + 0x1) & mask;
+	}
+	return slot;
+}
+
+uint32_t SDMSTRegistryAdd(struct SDMSTLibraryRegistry *registry, char *path, const char *installName, uint32_t kind, uint32_t loader, bool resolved) {
+	// Takes ownership of path. Entries are deduplicated on it, so the first library to link a dependency is its loader.
+	uint32_t slot = SDMSTRegistrySlot(registry, path);
+	if (registry->slots[slot]) {
+		free(path);
+		return registry->slots[slot] - 0x1;
+	}
+	if ((registry->count + 0x1) * 0x2 > registry->slotCount) {
+		free(registry->slots);
+		registry->slotCount <<= 0x1;
+		registry->slots = (uint32_t *)calloc(registry->slotCount, sizeof(uint32_t));
+		for (uint32_t i = 0x0; i < registry->count; i++)
+			registry->slots[SDMSTRegistrySlot(registry, registry->entries[i].path)] = i + 0x1;
+		slot = SDMSTRegistrySlot(registry, path);
+	}
+	registry->entries = realloc(registry->entries, sizeof(struct SDMSTRegistryEntry) * (registry->count + 0x1));
+	registry->entries[registry->count] = (struct SDMSTRegistryEntry){path, strdup(installName), NULL, (resolved ? kSDMSTLoadOK : kSDMSTLoadOpenFailed), kind, (loader == UINT32_MAX ? registry->count : loader)};
+	registry->count++;
+	registry->slots[slot] = registry->count;
+	return registry->count - 0x1;
+}
+
+struct SDMSTLibraryRegistry* SDMSTLoadDependencyClosure(char *path, struct SDMSTLoadOptions *options) {
+	// Breadth first: every library discovered at one depth is loaded in a single parallel batch, then the next depth is
+	// resolved from their load commands. The first entry is the library itself and also stands in for @executable_path.
+	if (path == NULL)
+		return NULL;
+	struct SDMSTLibraryRegistry *registry = (struct SDMSTLibraryRegistry *)calloc(0x1, sizeof(struct SDMSTLibraryRegistry));
+	registry->slotCount = 0x40;
+	registry->slots = (uint32_t *)calloc(registry->slotCount, sizeof(uint32_t));
+	char canonical[PATH_MAX];
+	SDMSTRegistryAdd(registry, strdup(realpath(path, canonical) ? canonical : path), path, kSDMSTDependencyLoad, UINT32_MAX, true);
+	uint32_t levelStart = 0x0;
+	while (levelStart < registry->count) {
+		uint32_t levelEnd = registry->count, pendingCount = 0x0;
+		uint32_t *pending = (uint32_t *)calloc(levelEnd - levelStart, sizeof(uint32_t));
+		char **paths = (char **)calloc(levelEnd - levelStart, sizeof(char *));
+		for (uint32_t i = levelStart; i < levelEnd; i++) {
+			if (registry->entries[i].status == kSDMSTLoadOK) {
+				pending[pendingCount] = i;
+				paths[pendingCount] = registry->entries[i].path;
+				pendingCount++;
+			}
+		}
+		struct SDMSTLoadResult *results = (struct SDMSTLoadResult *)calloc(pendingCount + 0x1, sizeof(struct SDMSTLoadResult));
+		if (pendingCount)
+			SDMSTLoadLibraries(paths, pendingCount, options, results);
+		for (uint32_t i = 0x0; i < pendingCount; i++) {
+			registry->entries[pending[i]].table = results[i].table;
+			registry->entries[pending[i]].status = results[i].status;
+		}
+		for (uint32_t i = 0x0; i < pendingCount; i++) {
+			if (registry->entries[pending[i]].table == NULL)
+				continue;
+			struct SDMSTDependency *dependencies = NULL;
+			uint32_t dependencyCount = SDMSTLibraryDependencies(registry->entries[pending[i]].table, &dependencies);
+			for (uint32_t j = 0x0; j < dependencyCount; j++) {
+				char *resolved = SDMSTResolveInstallName(registry, pending[i], dependencies[j].name);
+				bool found = (resolved != NULL);
+				SDMSTRegistryAdd(registry, (found ? resolved : strdup(dependencies[j].name)), dependencies[j].name, dependencies[j].kind, pending[i], found);
+			}
+			free(dependencies);
+		}
+		free(results);
+		free(paths);
+		free(pending);
+		levelStart = levelEnd;
+	}
+	return registry;
+}
+
+struct SDMSTRegistryEntry* SDMSTRegistryFind(struct SDMSTLibraryRegistry *registry, const char *path) {
+	struct SDMSTRegistryEntry *entry = NULL;
+	if (registry && path) {
+		uint32_t slot = SDMSTRegistrySlot(registry, path);
+		char canonical[PATH_MAX];
+		if (registry->slots[slot] == 0x0 && realpath(path, canonical))
+			slot = SDMSTRegistrySlot(registry, canonical);
+		if (registry->slots[slot])
+			entry = &(registry->entries[registry->slots[slot] - 0x1]);
+	}
+	return entry;
+}
+
+void SDMSTRegistryRelease(struct SDMSTLibraryRegistry *registry) {
+	if (registry) {
+		for (uint32_t i = 0x0; i < registry->count; i++) {
+			if (registry->entries[i].table)
+				SDMSTLibraryRelease(registry->entries[i].table);
+			free(registry->entries[i].path);
+			free(registry->entries[i].installName);
+		}
+		free(registry->entries);
+		free(registry->slots);
+		free(registry);
+	}
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ *  SDMSTLoader.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTLOADER_H_
+#define _SDMSTLOADER_H_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSymbolTable.h"
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTDependencyLoad 0x0
+#define kSDMSTDependencyWeak 0x1
+#define kSDMSTDependencyReexport 0x2
+#define kSDMSTDependencyUpward 0x3
+#define kSDMSTDependencyLazy 0x4
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTLoadResult {
+	struct SDMMOLibrarySymbolTable *table;
+	uint32_t status;
+} __attribute__ ((packed)) SDMSTLoadResult;
+
+typedef struct SDMSTDependency {
+	const char *name;
+	uint32_t kind;
+} __attribute__ ((packed)) SDMSTDependency;
+
+typedef struct SDMSTRegistryEntry {
+	char *path;
+	char *installName;
+	struct SDMMOLibrarySymbolTable *table;
+	uint32_t status;
+	uint32_t kind;
+	uint32_t loader;
+} __attribute__ ((packed)) SDMSTRegistryEntry;
+
+typedef struct SDMSTLibraryRegistry {
+	struct SDMSTRegistryEntry *entries;
+	uint32_t count;
+	uint32_t *slots;
+	uint32_t slotCount;
+} SDMSTLibraryRegistry;
+
+#pragma mark -
+#pragma mark Declarations
+
+uint32_t SDMSTLoadLibraries(char **paths, uint32_t count, struct SDMSTLoadOptions *options, struct SDMSTLoadResult *results);
+uint32_t SDMSTLibraryDependencies(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTDependency **dependencies);
+struct SDMSTLibraryRegistry* SDMSTLoadDependencyClosure(char *path, struct SDMSTLoadOptions *options);
+struct SDMSTRegistryEntry* SDMSTRegistryFind(struct SDMSTLibraryRegistry *registry, const char *path);
+void SDMSTRegistryRelease(struct SDMSTLibraryRegistry *registry);
+
+#endif
@@ -0,0 +1,431 @@
+/*
+ *  SDMSTPerfectHash.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTPERFECTHASH_C_
+#define _SDMSTPERFECTHASH_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTPerfectHash.h"
+#include "SDMSTString.h"
+#include "SDMSTWorkers.h"
+#include <string.h>
+
+#pragma mark -
+#pragma mark Internal Constants
+
+#define kSDMSTPerfectHashSeed 0x53444d5354504853ULL
+#define kSDMSTPerfectHashSeedAttempts 0x10
+#define kSDMSTPerfectHashPartitionKeys 0x1000
+#define kSDMSTPerfectHashBucketKeys 0x6
+#define kSDMSTPerfectHashLoadFactor 0.99
+#define kSDMSTPerfectHashMaxPilot 0xffff
+#define kSDMSTPerfectHashHashChunk 0x4000
+#define kSDMSTPerfectHashDenseKeys 0x9999999aULL
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTPerfectHashKey {
+	uint64_t hash;
+	uint32_t index;
+} SDMSTPerfectHashKey;
+
+typedef struct SDMSTPerfectHashPartitionBuild {
+	uint32_t keyCount;
+	uint32_t tableSize;
+	uint32_t bucketCount;
+	uint16_t *pilots;
+	uint32_t *remap;
+	uint32_t *slots;
+} SDMSTPerfectHashPartitionBuild;
+
+typedef struct SDMSTPerfectHashBuild {
+	char **names;
+	uint32_t count;
+	uint64_t seed;
+	uint64_t *hashes;
+	uint32_t partitionCount;
+	uint32_t *partitionStart;
+	struct SDMSTPerfectHashKey *keys;
+	struct SDMSTPerfectHashPartitionBuild *partitions;
+	uint32_t next;
+	bool failed;
+} SDMSTPerfectHashBuild;
+
+#pragma mark -
+#pragma mark Declarations
+
+uint64_t SDMSTHashMix(uint64_t value);
+uint32_t SDMSTPerfectHashPartitionOf(uint64_t hash, uint32_t partitionCount);
+uint32_t SDMSTPerfectHashBucketOf(uint64_t hash, uint32_t bucketCount);
+uint32_t SDMSTPerfectHashPosition(uint64_t hash, uint64_t seed, uint16_t pilot, uint32_t tableSize);
+int SDMSTPerfectHashCompareKeys(const void *entry1, const void *entry2);
+bool SDMSTPerfectHashBuildPartition(struct SDMSTPerfectHashBuild *build, uint32_t index);
+void* SDMSTPerfectHashHashWorker(void *context);
+void* SDMSTPerfectHashPartitionWorker(void *context);
+void SDMSTPerfectHashRunWorkers(struct SDMSTPerfectHashBuild *build, uint32_t threadCount, uint32_t workCount, void* (*worker)(void *));
+void SDMSTPerfectHashReleaseBuild(struct SDMSTPerfectHashBuild *build);
+bool SDMSTPerfectHashAttachStorage(struct SDMSTPerfectHash *hash);
+
+#pragma mark -
+#pragma mark Functions
+
+uint64_t SDMSTHashMix(uint64_t value) {
+	value ^= value >> 30;
+	value *= 0xbf58476d1ce4e5b9ULL;
+	value ^= value >> 27;
+	value *= 0x94d049bb133111ebULL;
+	value ^= value >> 31;
+	return value;
+}
+
+uint64_t SDMSTHashName(const char *name, uint64_t length, uint64_t seed) {
+	const uint64_t multiplier = 0xc6a4a7935bd1e995ULL;
+	const unsigned char *data = (const unsigned char *)name;
+	uint64_t hash = seed ^ (length * multiplier);
+	for (uint64_t i = 0x0; i < (length >> 3); i++) {
+		uint64_t block;
+		memcpy(&block, data, sizeof(uint64_t));
+		block *= multiplier;
+		block ^= block >> 47;
+		block *= multiplier;
+		hash ^= block;
+		hash *= multiplier;
+		data += sizeof(uint64_t);
+	}
+	if (length & 0x7) {
+		uint64_t tail = 0x0;
+		for (uint32_t i = (uint32_t)(length & 0x7); i > 0x0; i--)
+			tail = (tail << 8) | data[i-1];
+		hash ^= tail;
+		hash *= multiplier;
+	}
+	hash ^= hash >> 47;
+	hash *= multiplier;
+	hash ^= hash >> 47;
+	return hash;
+}
+
+uint32_t SDMSTPerfectHashPartitionOf(uint64_t hash, uint32_t partitionCount) {
+	return (uint32_t)(((hash >> 32) * (uint64_t)partitionCount) >> 32);
+}
+
+uint32_t SDMSTPerfectHashBucketOf(uint64_t hash, uint32_t bucketCount) {
+	// Skewed split: 60% of the keys land in the first 30% of the buckets, which get placed while the table is still empty.
+	uint64_t value = hash & 0xffffffff;
+	uint64_t denseCount = ((uint64_t)bucketCount * 0x3) / 0xa;
+	if (denseCount == 0x0 || denseCount == bucketCount)
+		return (uint32_t)((value * bucketCount) >> 32);
+	if (value < kSDMSTPerfectHashDenseKeys)
+		return (uint32_t)((value * denseCount) / kSDMSTPerfectHashDenseKeys);
+	return (uint32_t)(denseCount + (((value - kSDMSTPerfectHashDenseKeys) * (bucketCount - denseCount)) / (0x100000000ULL - kSDMSTPerfectHashDenseKeys)));
+}
+
+uint32_t SDMSTPerfectHashPosition(uint64_t hash, uint64_t seed, uint16_t pilot, uint32_t tableSize) {
+	return (uint32_t)((hash ^ SDMSTHashMix(seed + pilot)) % tableSize);
+}
+
+int SDMSTPerfectHashCompareKeys(const void *entry1, const void *entry2) {
+	const struct SDMSTPerfectHashKey *key1 = (const struct SDMSTPerfectHashKey *)entry1;
+	const struct SDMSTPerfectHashKey *key2 = (const struct SDMSTPerfectHashKey *)entry2;
+	if (key1->hash != key2->hash)
+		return (key1->hash < key2->hash ? -1 : 1);
+	if (key1->index != key2->index)
+		return (key1->index < key2->index ? -1 : 1);
+	return 0;
+}
+
+bool SDMSTPerfectHashBuildPartition(struct SDMSTPerfectHashBuild *build, uint32_t index) {
+	struct SDMSTPerfectHashPartitionBuild *partition = &build->partitions[index];
+	struct SDMSTPerfectHashKey *keys = &build->keys[build->partitionStart[index]];
+	uint32_t count = build->partitionStart[index+1] - build->partitionStart[index];
+	qsort(keys, count, sizeof(struct SDMSTPerfectHashKey), SDMSTPerfectHashCompareKeys);
+	// Identical names hash identically; keep the lowest index so lookups agree with a front-to-back scan.
+	uint32_t unique = 0x0;
+	for (uint32_t i = 0x0; i < count; i++) {
+		if (unique && keys[unique-1].hash == keys[i].hash) {
+			if (strcmp(build->names[keys[unique-1].index], build->names[keys[i].index]) != 0x0)
+				return false;
+			continue;
+		}
+		keys[unique++] = keys[i];
+	}
+	partition->keyCount = unique;
+	if (unique == 0x0)
+		return true;
+	partition->tableSize = (uint32_t)(unique / kSDMSTPerfectHashLoadFactor);
+	if (partition->tableSize < unique)
+		partition->tableSize = unique;
+	partition->bucketCount = (unique + kSDMSTPerfectHashBucketKeys - 1) / kSDMSTPerfectHashBucketKeys;
+	
+	uint32_t *bucketStart = (uint32_t *)calloc(partition->bucketCount + 0x2, sizeof(uint32_t));
+	uint32_t *bucketKeys = (uint32_t *)calloc(unique, sizeof(uint32_t));
+	uint32_t *order = (uint32_t *)calloc(partition->bucketCount, sizeof(uint32_t));
+	uint8_t *taken = (uint8_t *)calloc(partition->tableSize, sizeof(uint8_t));
+	partition->pilots = (uint16_t *)calloc(partition->bucketCount, sizeof(uint16_t));
+	partition->slots = (uint32_t *)calloc(unique, sizeof(uint32_t));
+	partition->remap = (uint32_t *)calloc(partition->tableSize - unique + 0x1, sizeof(uint32_t));
+	
+	uint32_t maxBucketSize = 0x0;
+	for (uint32_t i = 0x0; i < unique; i++)
+		bucketStart[SDMSTPerfectHashBucketOf(keys[i].hash, partition->bucketCount) + 0x2]++;
+	for (uint32_t i = 0x0; i < partition->bucketCount; i++) {
+		if (bucketStart[i+0x2] > maxBucketSize)
+			maxBucketSize = bucketStart[i+0x2];
+		bucketStart[i+0x2] += bucketStart[i+0x1];
+	}
+	for (uint32_t i = 0x0; i < unique; i++)
+		bucketKeys[bucketStart[SDMSTPerfectHashBucketOf(keys[i].hash, partition->bucketCount) + 0x1]++] = i;
+	
+	// Place the largest buckets first; ties keep bucket order so the build is deterministic.
+	uint32_t *sizeStart = (uint32_t *)calloc(maxBucketSize + 0x2, sizeof(uint32_t));
+	for (uint32_t i = 0x0; i < partition->bucketCount; i++)
+		sizeStart[maxBucketSize - (bucketStart[i+0x1] - bucketStart[i]) + 0x1]++;
+	for (uint32_t i = 0x0; i <= maxBucketSize; i++)
+		sizeStart[i+0x1] += sizeStart[i];
+	for (uint32_t i = 0x0; i < partition->bucketCount; i++)
+		order[sizeStart[maxBucketSize - (bucketStart[i+0x1] - bucketStart[i])]++] = i;
+	free(sizeStart);
+	
+	bool result = true;
+	uint32_t *positions = (uint32_t *)calloc(maxBucketSize + 0x1, sizeof(uint32_t));
+	for (uint32_t i = 0x0; i < partition->bucketCount && result; i++) {
+		uint32_t bucket = order[i];
+		uint32_t bucketSize = bucketStart[bucket+0x1] - bucketStart[bucket];
+		if (bucketSize == 0x0)
+			break;
+		bool placed = false;
+		for (uint32_t pilot = 0x0; pilot <= kSDMSTPerfectHashMaxPilot && !placed; pilot++) {
+			bool collides = false;
+			for (uint32_t j = 0x0; j < bucketSize && !collides; j++) {
+				uint32_t position = SDMSTPerfectHashPosition(keys[bucketKeys[bucketStart[bucket]+j]].hash, build->seed, (uint16_t)pilot, partition->tableSize);
+				collides = taken[position];
+				for (uint32_t k = 0x0; k < j && !collides; k++)
+					collides = (positions[k] == position);
+				positions[j] = position;
+			}
+			if (!collides) {
+				for (uint32_t j = 0x0; j < bucketSize; j++)
+					taken[positions[j]] = 0x1;
+				partition->pilots[bucket] = (uint16_t)pilot;
+				placed = true;
+			}
+		}
+		result = placed;
+	}
+	free(positions);
+	
+	if (result) {
+		// Slots past keyCount are folded back onto the free slots below it, which keeps the slot array minimal.
+		uint32_t freeSlot = 0x0;
+		for (uint32_t i = unique; i < partition->tableSize; i++) {
+			if (taken[i]) {
+				while (taken[freeSlot])
+					freeSlot++;
+				partition->remap[i - unique] = freeSlot++;
+			}
+		}
+		for (uint32_t i = 0x0; i < unique; i++) {
+			uint16_t pilot = partition->pilots[SDMSTPerfectHashBucketOf(keys[i].hash, partition->bucketCount)];
+			uint32_t position = SDMSTPerfectHashPosition(keys[i].hash, build->seed, pilot, partition->tableSize);
+			if (position >= unique)
+				position = partition->remap[position - unique];
+			partition->slots[position] = keys[i].index;
+		}
+	}
+	free(taken);
+	free(order);
+	free(bucketKeys);
+	free(bucketStart);
+	return result;
+}
+
+void* SDMSTPerfectHashHashWorker(void *context) {
+	struct SDMSTPerfectHashBuild *build = (struct SDMSTPerfectHashBuild *)context;
+	uint32_t chunkCount = (build->count + kSDMSTPerfectHashHashChunk - 1) / kSDMSTPerfectHashHashChunk;
+	for (uint32_t chunk = __atomic_fetch_add(&build->next, 0x1, __ATOMIC_RELAXED); chunk < chunkCount; chunk = __atomic_fetch_add(&build->next, 0x1, __ATOMIC_RELAXED)) {
+		uint32_t end = (chunk + 0x1) * kSDMSTPerfectHashHashChunk;
+		if (end > build->count)
+			end = build->count;
+		for (uint32_t i = chunk * kSDMSTPerfectHashHashChunk; i < end; i++) {
+			char *name = (build->names[i] ? build->names[i] : "");
+			build->hashes[i] = SDMSTHashName(name, SDMSTStringLength(name), build->seed);
+		}
+	}
+	return NULL;
+}
+
+void* SDMSTPerfectHashPartitionWorker(void *context) {
+	struct SDMSTPerfectHashBuild *build = (struct SDMSTPerfectHashBuild *)context;
+	for (uint32_t index = __atomic_fetch_add(&build->next, 0x1, __ATOMIC_RELAXED); index < build->partitionCount; index = __atomic_fetch_add(&build->next, 0x1, __ATOMIC_RELAXED)) {
+		if (__atomic_load_n(&build->failed, __ATOMIC_RELAXED))
+			break;
+		if (!SDMSTPerfectHashBuildPartition(build, index))
+			__atomic_store_n(&build->failed, true, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+void SDMSTPerfectHashRunWorkers(struct SDMSTPerfectHashBuild *build, uint32_t threadCount, uint32_t workCount, void* (*worker)(void *)) {
+	build->next = 0x0;
+	SDMSTRunWorkers(threadCount, workCount, worker, build);
+}
+
+void SDMSTPerfectHashReleaseBuild(struct SDMSTPerfectHashBuild *build) {
+	if (build->partitions) {
+		for (uint32_t i = 0x0; i < build->partitionCount; i++) {
+			free(build->partitions[i].pilots);
+			free(build->partitions[i].remap);
+			free(build->partitions[i].slots);
+		}
+	}
+	free(build->partitions);
+	free(build->keys);
+	free(build->partitionStart);
+	free(build->hashes);
+	build->partitions = NULL;
+	build->keys = NULL;
+	build->partitionStart = NULL;
+	build->hashes = NULL;
+}
+
+bool SDMSTPerfectHashAttachStorage(struct SDMSTPerfectHash *hash) {
+	if (hash->storageSize < sizeof(struct SDMSTPerfectHashHeader))
+		return false;
+	hash->header = (struct SDMSTPerfectHashHeader *)hash->storage;
+	if (hash->header->magic != kSDMSTPerfectHashMagic || hash->header->version != kSDMSTPerfectHashVersion)
+		return false;
+	uint64_t offset = sizeof(struct SDMSTPerfectHashHeader);
+	hash->partitions = (struct SDMSTPerfectHashPartition *)((char*)hash->storage + offset);
+	offset += (uint64_t)hash->header->partitionCount * sizeof(struct SDMSTPerfectHashPartition);
+	hash->pilots = (uint16_t *)((char*)hash->storage + offset);
+	offset += (((uint64_t)hash->header->bucketCount * sizeof(uint16_t)) + 0x3) & ~0x3ULL;
+	hash->remap = (uint32_t *)((char*)hash->storage + offset);
+	offset += (uint64_t)hash->header->remapCount * sizeof(uint32_t);
+	hash->slots = (uint32_t *)((char*)hash->storage + offset);
+	offset += (uint64_t)hash->header->keyCount * sizeof(uint32_t);
+	return (offset <= hash->storageSize);
+}
+
+struct SDMSTPerfectHash* SDMSTPerfectHashCreate(char **names, uint32_t count, uint32_t threadCount) {
+	struct SDMSTPerfectHash *hash = NULL;
+	struct SDMSTPerfectHashBuild build = {0};
+	build.names = names;
+	build.count = count;
+	build.seed = kSDMSTPerfectHashSeed;
+	build.partitionCount = (count + kSDMSTPerfectHashPartitionKeys - 1) / kSDMSTPerfectHashPartitionKeys;
+	if (build.partitionCount == 0x0)
+		build.partitionCount = 0x1;
+	for (uint32_t attempt = 0x0; attempt < kSDMSTPerfectHashSeedAttempts && hash == NULL; attempt++) {
+		build.failed = false;
+		build.hashes = (uint64_t *)calloc(count + 0x1, sizeof(uint64_t));
+		build.keys = (struct SDMSTPerfectHashKey *)calloc(count + 0x1, sizeof(struct SDMSTPerfectHashKey));
+		build.partitionStart = (uint32_t *)calloc(build.partitionCount + 0x2, sizeof(uint32_t));
+		build.partitions = (struct SDMSTPerfectHashPartitionBuild *)calloc(build.partitionCount, sizeof(struct SDMSTPerfectHashPartitionBuild));
+		SDMSTPerfectHashRunWorkers(&build, threadCount, (count + kSDMSTPerfectHashHashChunk - 1) / kSDMSTPerfectHashHashChunk, SDMSTPerfectHashHashWorker);
+		for (uint32_t i = 0x0; i < count; i++)
+			build.partitionStart[SDMSTPerfectHashPartitionOf(build.hashes[i], build.partitionCount) + 0x2]++;
+		for (uint32_t i = 0x0; i < build.partitionCount; i++)
+			build.partitionStart[i+0x2] += build.partitionStart[i+0x1];
+		for (uint32_t i = 0x0; i < count; i++)
+			build.keys[build.partitionStart[SDMSTPerfectHashPartitionOf(build.hashes[i], build.partitionCount) + 0x1]++] = (struct SDMSTPerfectHashKey){build.hashes[i], i};
+		SDMSTPerfectHashRunWorkers(&build, threadCount, build.partitionCount, SDMSTPerfectHashPartitionWorker);
+		if (!build.failed) {
+			uint32_t keyCount = 0x0, bucketCount = 0x0, remapCount = 0x0;
+			for (uint32_t i = 0x0; i < build.partitionCount; i++) {
+				keyCount += build.partitions[i].keyCount;
+				bucketCount += build.partitions[i].bucketCount;
+				remapCount += build.partitions[i].tableSize - build.partitions[i].keyCount;
+			}
+			hash = (struct SDMSTPerfectHash *)calloc(0x1, sizeof(struct SDMSTPerfectHash));
+			hash->storageSize = sizeof(struct SDMSTPerfectHashHeader) + (uint64_t)build.partitionCount * sizeof(struct SDMSTPerfectHashPartition) + ((((uint64_t)bucketCount * sizeof(uint16_t)) + 0x3) & ~0x3ULL) + (uint64_t)remapCount * sizeof(uint32_t) + (uint64_t)keyCount * sizeof(uint32_t);
+			hash->storage = calloc(0x1, hash->storageSize);
+			hash->ownsStorage = true;
+			*(struct SDMSTPerfectHashHeader *)hash->storage = (struct SDMSTPerfectHashHeader){kSDMSTPerfectHashMagic, kSDMSTPerfectHashVersion, build.seed, keyCount, build.partitionCount, bucketCount, remapCount};
+			SDMSTPerfectHashAttachStorage(hash);
+			uint32_t slotOffset = 0x0, bucketOffset = 0x0, remapOffset = 0x0;
+			for (uint32_t i = 0x0; i < build.partitionCount; i++) {
+				struct SDMSTPerfectHashPartitionBuild *partition = &build.partitions[i];
+				uint32_t partitionRemap = partition->tableSize - partition->keyCount;
+				hash->partitions[i] = (struct SDMSTPerfectHashPartition){slotOffset, partition->keyCount, partition->tableSize, bucketOffset, partition->bucketCount, remapOffset};
+				if (partition->keyCount) {
+					memcpy(&hash->pilots[bucketOffset], partition->pilots, partition->bucketCount * sizeof(uint16_t));
+					memcpy(&hash->remap[remapOffset], partition->remap, partitionRemap * sizeof(uint32_t));
+					memcpy(&hash->slots[slotOffset], partition->slots, partition->keyCount * sizeof(uint32_t));
+				}
+				slotOffset += partition->keyCount;
+				bucketOffset += partition->bucketCount;
+				remapOffset += partitionRemap;
+			}
+		}
+		SDMSTPerfectHashReleaseBuild(&build);
+		build.seed = SDMSTHashMix(build.seed + attempt + 0x1);
+	}
+	return hash;
+}
+
+struct SDMSTPerfectHash* SDMSTPerfectHashCreateFromBuffer(void *buffer, uint64_t size) {
+	struct SDMSTPerfectHash *hash = NULL;
+	if (buffer) {
+		hash = (struct SDMSTPerfectHash *)calloc(0x1, sizeof(struct SDMSTPerfectHash));
+		hash->storage = buffer;
+		hash->storageSize = size;
+		hash->ownsStorage = false;
+		if (!SDMSTPerfectHashAttachStorage(hash)) {
+			free(hash);
+			hash = NULL;
+		}
+	}
+	return hash;
+}
+
+uint32_t SDMSTPerfectHashLookup(struct SDMSTPerfectHash *hash, const char *name, uint64_t length) {
+	uint32_t result = kSDMSTPerfectHashNotFound;
+	if (hash && name && hash->header->keyCount) {
+		uint64_t value = SDMSTHashName(name, length, hash->header->seed);
+		struct SDMSTPerfectHashPartition *partition = &hash->partitions[SDMSTPerfectHashPartitionOf(value, hash->header->partitionCount)];
+		if (partition->keyCount) {
+			uint16_t pilot = hash->pilots[partition->bucketOffset + SDMSTPerfectHashBucketOf(value, partition->bucketCount)];
+			uint32_t position = SDMSTPerfectHashPosition(value, hash->header->seed, pilot, partition->tableSize);
+			if (position >= partition->keyCount)
+				position = hash->remap[partition->remapOffset + (position - partition->keyCount)];
+			result = hash->slots[partition->slotOffset + position];
+		}
+	}
+	return result;
+}
+
+uint64_t SDMSTPerfectHashSerializedSize(struct SDMSTPerfectHash *hash) {
+	return (hash ? hash->storageSize : 0x0);
+}
+
+void SDMSTPerfectHashSerialize(struct SDMSTPerfectHash *hash, void *buffer) {
+	if (hash && buffer)
+		memcpy(buffer, hash->storage, hash->storageSize);
+}
+
+void SDMSTPerfectHashRelease(struct SDMSTPerfectHash *hash) {
+	if (hash) {
+		if (hash->ownsStorage)
+			free(hash->storage);
+		free(hash);
+	}
+}
+
+#endif
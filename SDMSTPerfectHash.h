@@ -0,0 +1,80 @@
+/*
+ *  SDMSTPerfectHash.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTPERFECTHASH_H_
+#define _SDMSTPERFECTHASH_H_
+
+#pragma mark -
+#pragma mark Includes
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTPerfectHashMagic 0x48504d53
+#define kSDMSTPerfectHashVersion 0x1
+#define kSDMSTPerfectHashNotFound 0xffffffff
+
+#pragma mark -
+#pragma mark Types
+
+// Serialized layout, in this order: header, partitions, pilots (uint16_t per bucket), remap (uint32_t per displaced slot), slots (uint32_t per key).
+typedef struct SDMSTPerfectHashHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t seed;
+	uint32_t keyCount;
+	uint32_t partitionCount;
+	uint32_t bucketCount;
+	uint32_t remapCount;
+} __attribute__ ((packed)) SDMSTPerfectHashHeader;
+
+typedef struct SDMSTPerfectHashPartition {
+	uint32_t slotOffset;
+	uint32_t keyCount;
+	uint32_t tableSize;
+	uint32_t bucketOffset;
+	uint32_t bucketCount;
+	uint32_t remapOffset;
+} __attribute__ ((packed)) SDMSTPerfectHashPartition;
+
+typedef struct SDMSTPerfectHash {
+	struct SDMSTPerfectHashHeader *header;
+	struct SDMSTPerfectHashPartition *partitions;
+	uint16_t *pilots;
+	uint32_t *remap;
+	uint32_t *slots;
+	void *storage;
+	uint64_t storageSize;
+	bool ownsStorage;
+} SDMSTPerfectHash;
+
+#pragma mark -
+#pragma mark Declarations
+
+uint64_t SDMSTHashName(const char *name, uint64_t length, uint64_t seed);
+struct SDMSTPerfectHash* SDMSTPerfectHashCreate(char **names, uint32_t count, uint32_t threadCount);
+struct SDMSTPerfectHash* SDMSTPerfectHashCreateFromBuffer(void *buffer, uint64_t size);
+uint32_t SDMSTPerfectHashLookup(struct SDMSTPerfectHash *hash, const char *name, uint64_t length);
+uint64_t SDMSTPerfectHashSerializedSize(struct SDMSTPerfectHash *hash);
+void SDMSTPerfectHashSerialize(struct SDMSTPerfectHash *hash, void *buffer);
+void SDMSTPerfectHashRelease(struct SDMSTPerfectHash *hash);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ *  SDMSTProtocol.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTPROTOCOL_C_
+#define _SDMSTPROTOCOL_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTProtocol.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0x0
+#endif
+
+#pragma mark -
+#pragma mark Functions
+
+void SDMSTProtocolConfigureSocket(int fd) {
+#ifdef SO_NOSIGPIPE
+	int enable = 0x1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(int));
+#else
+	(void)fd;
+#endif
+}
+
+bool SDMSTProtocolSendMessage(int fd, const void *header, uint32_t headerSize, const void *payload, uint32_t length) {
+	// Header and payload leave in one sendmsg so small replies cost a single syscall.
+	struct iovec vectors[0x2] = {{(void *)header, headerSize}, {(void *)payload, (payload ? length : 0x0)}};
+	struct msghdr message;
+	memset(&message, 0x0, sizeof(struct msghdr));
+	message.msg_iov = vectors;
+	message.msg_iovlen = 0x2;
+	while (vectors[0x0].iov_len || vectors[0x1].iov_len) {
+		ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+		if (sent < 0x0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		for (uint32_t i = 0x0; i < 0x2 && sent; i++) {
+			size_t consumed = ((size_t)sent < vectors[i].iov_len ? (size_t)sent : vectors[i].iov_len);
+			vectors[i].iov_base = (char *)vectors[i].iov_base + consumed;
+			vectors[i].iov_len -= consumed;
+			sent -= consumed;
+		}
+		message.msg_iov = (vectors[0x0].iov_len ? &vectors[0x0] : &vectors[0x1]);
+		message.msg_iovlen = (vectors[0x0].iov_len ? 0x2 : 0x1);
+	}
+	return true;
+}
+
+bool SDMSTProtocolReceive(int fd, void *buffer, uint64_t length) {
+	char *cursor = (char *)buffer;
+	while (length) {
+		ssize_t received = recv(fd, cursor, length, 0x0);
+		if (received < 0x0 && errno == EINTR)
+			continue;
+		if (received <= 0x0)
+			return false;
+		cursor += received;
+		length -= (uint64_t)received;
+	}
+	return true;
+}
+
+#endif
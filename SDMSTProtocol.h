@@ -0,0 +1,105 @@
+/*
+ *  SDMSTProtocol.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTPROTOCOL_H_
+#define _SDMSTPROTOCOL_H_
+
+#pragma mark -
+#pragma mark Includes
+#include <stdint.h>
+#include <stdbool.h>
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTProtocolMagic 0x54534453
+#define kSDMSTProtocolVersion 0x1
+#define kSDMSTProtocolMaximumPayload 0x1000000
+#define kSDMSTProtocolUUIDSize 0x10
+#define kSDMSTSymbolReplyUnresolved 0xffffffff
+
+/*
+ *	Every message is a fixed header followed by `length` payload bytes, in host byte order (the socket is local).
+ *	Addresses on the wire are unslid vmaddrs as they appear in the binary, so they mean the same thing in every process.
+ *
+ *	kSDMSTOpRegister        request: uuid[0x10] (all zero accepts any) + path bytes    reply: SDMSTRegisterReply
+ *	kSDMSTOpLookupName      request: name bytes                                        reply: uint64_t address
+ *	kSDMSTOpLookupAddress   request: uint64_t address                                  reply: SDMSTSymbolReply + name bytes
+ *	kSDMSTOpSymbolizeBatch  request: uint64_t addresses[n]                             reply: SDMSTSymbolReply[n] + name pool
+ *
+ *	SDMSTSymbolReply.nameOffset is relative to the first byte after the reply array, or kSDMSTSymbolReplyUnresolved.
+ */
+
+enum SDMSTProtocolOpcode {
+	kSDMSTOpRegister = 0x1,
+	kSDMSTOpLookupName = 0x2,
+	kSDMSTOpLookupAddress = 0x3,
+	kSDMSTOpSymbolizeBatch = 0x4
+};
+
+enum SDMSTProtocolStatus {
+	kSDMSTStatusOK = 0x0,
+	kSDMSTStatusNotFound = 0x1,
+	kSDMSTStatusBadRequest = 0x2,
+	kSDMSTStatusNoTable = 0x3,
+	kSDMSTStatusLoadFailed = 0x4,
+	kSDMSTStatusUUIDMismatch = 0x5,
+	kSDMSTStatusTransportError = 0x6
+};
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTRequestHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t opcode;
+	uint32_t tableId;
+	uint32_t length;
+} __attribute__ ((packed)) SDMSTRequestHeader;
+
+typedef struct SDMSTResponseHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t status;
+	uint32_t length;
+} __attribute__ ((packed)) SDMSTResponseHeader;
+
+typedef struct SDMSTRegisterReply {
+	uint32_t tableId;
+	uint8_t uuid[kSDMSTProtocolUUIDSize];
+	uint32_t symbolCount;
+	uint64_t textAddress;
+	uint64_t textSize;
+} __attribute__ ((packed)) SDMSTRegisterReply;
+
+typedef struct SDMSTSymbolReply {
+	uint64_t address;
+	uint64_t offset;
+	uint32_t nameOffset;
+	uint32_t nameLength;
+} __attribute__ ((packed)) SDMSTSymbolReply;
+
+#pragma mark -
+#pragma mark Declarations
+
+void SDMSTProtocolConfigureSocket(int fd);
+bool SDMSTProtocolSendMessage(int fd, const void *header, uint32_t headerSize, const void *payload, uint32_t length);
+bool SDMSTProtocolReceive(int fd, void *buffer, uint64_t length);
+
+#endif
@@ -0,0 +1,403 @@
+/*
+ *  SDMSTServer.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSERVER_C_
+#define _SDMSTSERVER_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTServer.h"
+#include "SDMSTSymbolicate.h"
+#include "SDMMachO.h"
+#include "SDMSTCommandIndex.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTServerConnection {
+	struct SDMSTServer *server;
+	int fd;
+	char *request;
+	uint32_t requestCapacity;
+	char *response;
+	uint32_t responseCapacity;
+	void **addresses;
+	struct SDMSTSymbolicatedAddress *results;
+	uint32_t addressCapacity;
+} SDMSTServerConnection;
+
+#pragma mark -
+#pragma mark Declarations
+
+bool SDMSTServerFileUUID(char *path, uint8_t *uuid, bool *hasUUID);
+struct SDMSTServerTable* SDMSTServerTableForId(struct SDMSTServer *server, uint32_t tableId);
+char* SDMSTServerReserve(char **buffer, uint32_t *capacity, uint64_t length);
+uint16_t SDMSTServerHandleRegister(struct SDMSTServerConnection *connection, uint32_t length, uint32_t *replyLength);
+uint16_t SDMSTServerHandleLookupName(struct SDMSTServerConnection *connection, struct SDMSTServerTable *table, uint32_t length, uint32_t *replyLength);
+uint16_t SDMSTServerHandleLookupAddress(struct SDMSTServerConnection *connection, struct SDMSTServerTable *table, uint32_t length, uint32_t *replyLength);
+uint16_t SDMSTServerHandleBatch(struct SDMSTServerConnection *connection, struct SDMSTServerTable *table, uint32_t length, uint32_t *replyLength);
+void* SDMSTServerConnectionWorker(void *context);
+
+#pragma mark -
+#pragma mark Functions
+
+bool SDMSTServerFileUUID(char *path, uint8_t *uuid, bool *hasUUID) {
+	// Reads only the header and load commands so a re-register can tell whether the binary changed without reloading it.
+	*hasUUID = false;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0x0)
+		return false;
+	struct stat fs;
+	struct SDMSTFatSlice *slices = NULL;
+	uint32_t sliceCount = (fstat(fd, &fs) == 0x0 ? SDMSTReadSlices(fd, (uint64_t)fs.st_size, &slices) : 0x0);
+	int32_t selected = SDMSTSelectSlice(slices, sliceCount, 0x0, 0x0);
+	// Same slice SDMSTLoadLibrary maps by default.
+	off_t base = (selected >= 0x0 ? (off_t)slices[selected].offset : 0x0);
+	struct mach_header_64 header;
+	uint64_t commandsSize = 0x0;
+	free(slices);
+	if (selected >= 0x0 && pread(fd, &header, sizeof(struct mach_header_64), base) >= (ssize_t)sizeof(struct mach_header))
+		commandsSize = SDMSTImageCommandsSize((struct mach_header *)&header);
+	if (commandsSize && commandsSize <= kSDMSTProtocolMaximumPayload) {
+		// Foreign-endian images are swapped like a loaded one, so the walk below only ever sees host order.
+		char *image = (char *)calloc((size_t)commandsSize + 0x1, sizeof(char));
+		bool swapped = (header.magic == MH_CIGAM || header.magic == MH_CIGAM_64);
+		if (pread(fd, image, (size_t)commandsSize, base) == (ssize_t)commandsSize && (!swapped || SDMSTSwapImageCommands(image, commandsSize))) {
+			struct SDMSTCommandIndex *index = SDMSTCommandIndexCreate((struct mach_header *)image, commandsSize);
+			struct SDMSTLoadCommandEntry *entry = SDMSTCommandFind(index, LC_UUID);
+			if (entry) {
+				memcpy(uuid, ((struct uuid_command *)entry->command)->uuid, kSDMSTProtocolUUIDSize);
+				*hasUUID = true;
+			}
+			SDMSTCommandIndexRelease(index);
+		}
+		free(image);
+	}
+	close(fd);
+	return true;
+}
+
+struct SDMSTServer* SDMSTServerCreate(char *socketPath) {
+	struct SDMSTServer *server = (struct SDMSTServer *)calloc(0x1, sizeof(struct SDMSTServer));
+	server->socketPath = strdup(socketPath);
+	server->listenFd = -0x1;
+	pthread_rwlock_init(&server->tableLock, NULL);
+	pthread_mutex_init(&server->loadLock, NULL);
+	pthread_mutex_init(&server->connectionLock, NULL);
+	pthread_cond_init(&server->connectionDrained, NULL);
+	// Armed here rather than in SDMSTServerRun so a stop requested before the loop starts is not overwritten.
+	server->running = true;
+	return server;
+}
+
+struct SDMSTServerTable* SDMSTServerTableForId(struct SDMSTServer *server, uint32_t tableId) {
+	struct SDMSTServerTable *table = NULL;
+	pthread_rwlock_rdlock(&server->tableLock);
+	if (tableId < server->tableCount)
+		table = server->tables[tableId];
+	pthread_rwlock_unlock(&server->tableLock);
+	return table;
+}
+
+uint16_t SDMSTServerRegister(struct SDMSTServer *server, char *path, uint8_t *expectedUUID, uint32_t *tableId) {
+	char resolved[PATH_MAX];
+	char *canonical = (realpath(path, resolved) ? resolved : path);
+	uint8_t uuid[kSDMSTProtocolUUIDSize], zero[kSDMSTProtocolUUIDSize];
+	memset(uuid, 0x0, kSDMSTProtocolUUIDSize);
+	memset(zero, 0x0, kSDMSTProtocolUUIDSize);
+	bool hasUUID = false;
+	if (!SDMSTServerFileUUID(canonical, uuid, &hasUUID))
+		return kSDMSTStatusLoadFailed;
+	if (expectedUUID && memcmp(expectedUUID, zero, kSDMSTProtocolUUIDSize) && (!hasUUID || memcmp(expectedUUID, uuid, kSDMSTProtocolUUIDSize)))
+		return kSDMSTStatusUUIDMismatch;
+	uint16_t status = kSDMSTStatusOK;
+	// Loads are serialised so two clients registering the same binary share one table; queries never take this lock.
+	pthread_mutex_lock(&server->loadLock);
+	bool found = false;
+	for (uint32_t i = server->tableCount; i > 0x0 && !found; i--) {
+		struct SDMSTServerTable *table = server->tables[i - 0x1];
+		if (!strcmp(table->path, canonical) && (!hasUUID || !memcmp(table->uuid, uuid, kSDMSTProtocolUUIDSize))) {
+			*tableId = i - 0x1;
+			found = true;
+		}
+	}
+	if (!found) {
+		struct SDMSTServerTable *table = (struct SDMSTServerTable *)calloc(0x1, sizeof(struct SDMSTServerTable));
+		table->path = strdup(canonical);
+		// Client paths are never handed to dyld: the daemon must not run their initializers, and the table has to describe
+		// the file now on disk rather than an image dyld loaded from the same path before it was rebuilt.
+		table->libTable = SDMSTLoadLibraryWithOptions(table->path, &(struct SDMSTLoadOptions){{0x0, 0x0}, 0x0, 0x0, NULL, false, true});
+		if (table->libTable->libInfo && table->libTable->table) {
+			SDMSTBuildNameIndex(table->libTable, 0x0);
+			SDMSTBuildPageIndex(table->libTable);
+			if (!SDMSTLibraryUUID(table->libTable, table->uuid))
+				memcpy(table->uuid, uuid, kSDMSTProtocolUUIDSize);
+			struct SDMSTSeg64Data textData = SDMSTSegmentData(table->libTable->libInfo->textSeg, table->libTable->libInfo->is64bit);
+			table->textAddress = textData.vmaddr;
+			table->textSize = textData.vmsize;
+			pthread_rwlock_wrlock(&server->tableLock);
+			server->tables = realloc(server->tables, sizeof(struct SDMSTServerTable *)*(server->tableCount+0x1));
+			server->tables[server->tableCount] = table;
+			*tableId = server->tableCount;
+			server->tableCount++;
+			pthread_rwlock_unlock(&server->tableLock);
+		} else {
+			SDMSTLibraryRelease(table->libTable);
+			free(table->path);
+			free(table);
+			status = kSDMSTStatusLoadFailed;
+		}
+	}
+	pthread_mutex_unlock(&server->loadLock);
+	return status;
+}
+
+char* SDMSTServerReserve(char **buffer, uint32_t *capacity, uint64_t length) {
+	if (length > *capacity) {
+		*buffer = realloc(*buffer, length);
+		*capacity = (uint32_t)length;
+	}
+	return *buffer;
+}
+
+uint16_t SDMSTServerHandleRegister(struct SDMSTServerConnection *connection, uint32_t length, uint32_t *replyLength) {
+	if (length <= kSDMSTProtocolUUIDSize)
+		return kSDMSTStatusBadRequest;
+	char *path = (char *)calloc(length - kSDMSTProtocolUUIDSize + 0x1, sizeof(char));
+	memcpy(path, connection->request + kSDMSTProtocolUUIDSize, length - kSDMSTProtocolUUIDSize);
+	uint32_t tableId = 0x0;
+	uint16_t status = SDMSTServerRegister(connection->server, path, (uint8_t *)connection->request, &tableId);
+	free(path);
+	if (status == kSDMSTStatusOK) {
+		struct SDMSTServerTable *table = SDMSTServerTableForId(connection->server, tableId);
+		struct SDMSTRegisterReply *reply = (struct SDMSTRegisterReply *)SDMSTServerReserve(&connection->response, &connection->responseCapacity, sizeof(struct SDMSTRegisterReply));
+		reply->tableId = tableId;
+		memcpy(reply->uuid, table->uuid, kSDMSTProtocolUUIDSize);
+		reply->symbolCount = table->libTable->symbolCount;
+		reply->textAddress = table->textAddress;
+		reply->textSize = table->textSize;
+		*replyLength = sizeof(struct SDMSTRegisterReply);
+	}
+	return status;
+}
+
+uint16_t SDMSTServerHandleLookupName(struct SDMSTServerConnection *connection, struct SDMSTServerTable *table, uint32_t length, uint32_t *replyLength) {
+	if (length == 0x0)
+		return kSDMSTStatusBadRequest;
+	char *name = SDMSTServerReserve(&connection->request, &connection->requestCapacity, (uint64_t)length + 0x1);
+	name[length] = '\0';
+	void* address = (void*)SDMSTSymbolLookup(table->libTable, name);
+	if (address == NULL)
+		return kSDMSTStatusNotFound;
+	uint64_t *reply = (uint64_t *)SDMSTServerReserve(&connection->response, &connection->responseCapacity, sizeof(uint64_t));
+	*reply = (uint64_t)((uintptr_t)address - table->libTable->libInfo->vmSlide);
+	*replyLength = sizeof(uint64_t);
+	return kSDMSTStatusOK;
+}
+
+uint16_t SDMSTServerHandleLookupAddress(struct SDMSTServerConnection *connection, struct SDMSTServerTable *table, uint32_t length, uint32_t *replyLength) {
+	if (length != sizeof(uint64_t))
+		return kSDMSTStatusBadRequest;
+	uint64_t address = *(uint64_t *)connection->request;
+	uint64_t offset = 0x0;
+	struct SDMSTMachOSymbol *symbol = SDMSTSymbolForAddress(table->libTable, (void*)((uintptr_t)address + table->libTable->libInfo->vmSlide), &offset);
+	if (symbol == NULL)
+		return kSDMSTStatusNotFound;
+	char *response = SDMSTServerReserve(&connection->response, &connection->responseCapacity, (uint64_t)sizeof(struct SDMSTSymbolReply) + symbol->nameLength);
+	*(struct SDMSTSymbolReply *)response = (struct SDMSTSymbolReply){(uint64_t)((uintptr_t)symbol->offset - table->libTable->libInfo->vmSlide), offset, 0x0, symbol->nameLength};
+	memcpy(response + sizeof(struct SDMSTSymbolReply), symbol->name, symbol->nameLength);
+	*replyLength = sizeof(struct SDMSTSymbolReply) + symbol->nameLength;
+	return kSDMSTStatusOK;
+}
+
+uint16_t SDMSTServerHandleBatch(struct SDMSTServerConnection *connection, struct SDMSTServerTable *table, uint32_t length, uint32_t *replyLength) {
+	if (length % sizeof(uint64_t))
+		return kSDMSTStatusBadRequest;
+	uint32_t count = length / sizeof(uint64_t);
+	if (count > connection->addressCapacity) {
+		connection->addresses = realloc(connection->addresses, sizeof(void*)*count);
+		connection->results = realloc(connection->results, sizeof(struct SDMSTSymbolicatedAddress)*count);
+		connection->addressCapacity = count;
+	}
+	intptr_t slide = table->libTable->libInfo->vmSlide;
+	for (uint32_t i = 0x0; i < count; i++)
+		connection->addresses[i] = (void*)((uintptr_t)((uint64_t *)connection->request)[i] + slide);
+	SDMSTSymbolizeAddresses(table->libTable, connection->addresses, count, connection->results);
+	uint64_t total = (uint64_t)sizeof(struct SDMSTSymbolReply) * count;
+	for (uint32_t i = 0x0; i < count; i++)
+		if (connection->results[i].symbol)
+			total += connection->results[i].symbol->nameLength;
+	if (total > UINT32_MAX)
+		return kSDMSTStatusBadRequest;
+	char *response = SDMSTServerReserve(&connection->response, &connection->responseCapacity, total);
+	struct SDMSTSymbolReply *replies = (struct SDMSTSymbolReply *)response;
+	char *names = response + sizeof(struct SDMSTSymbolReply) * count;
+	uint32_t nameOffset = 0x0;
+	for (uint32_t i = 0x0; i < count; i++) {
+		struct SDMSTMachOSymbol *symbol = connection->results[i].symbol;
+		if (symbol) {
+			replies[i] = (struct SDMSTSymbolReply){(uint64_t)((uintptr_t)symbol->offset - slide), connection->results[i].offset, nameOffset, symbol->nameLength};
+			memcpy(names + nameOffset, symbol->name, symbol->nameLength);
+			nameOffset += symbol->nameLength;
+		} else {
+			replies[i] = (struct SDMSTSymbolReply){0x0, 0x0, kSDMSTSymbolReplyUnresolved, 0x0};
+		}
+	}
+	*replyLength = (uint32_t)total;
+	return kSDMSTStatusOK;
+}
+
+void* SDMSTServerConnectionWorker(void *context) {
+	struct SDMSTServerConnection *connection = (struct SDMSTServerConnection *)context;
+	struct SDMSTServer *server = connection->server;
+	struct SDMSTRequestHeader request;
+	while (SDMSTProtocolReceive(connection->fd, &request, sizeof(struct SDMSTRequestHeader))) {
+		if (request.magic != kSDMSTProtocolMagic || request.version != kSDMSTProtocolVersion || request.length > kSDMSTProtocolMaximumPayload)
+			break;
+		SDMSTServerReserve(&connection->request, &connection->requestCapacity, (uint64_t)request.length + 0x1);
+		if (!SDMSTProtocolReceive(connection->fd, connection->request, request.length))
+			break;
+		uint32_t replyLength = 0x0;
+		uint16_t status = kSDMSTStatusBadRequest;
+		if (request.opcode == kSDMSTOpRegister) {
+			status = SDMSTServerHandleRegister(connection, request.length, &replyLength);
+		} else {
+			struct SDMSTServerTable *table = SDMSTServerTableForId(server, request.tableId);
+			if (table == NULL) {
+				status = kSDMSTStatusNoTable;
+			} else if (request.opcode == kSDMSTOpLookupName) {
+				status = SDMSTServerHandleLookupName(connection, table, request.length, &replyLength);
+			} else if (request.opcode == kSDMSTOpLookupAddress) {
+				status = SDMSTServerHandleLookupAddress(connection, table, request.length, &replyLength);
+			} else if (request.opcode == kSDMSTOpSymbolizeBatch) {
+				status = SDMSTServerHandleBatch(connection, table, request.length, &replyLength);
+			}
+		}
+		if (status != kSDMSTStatusOK)
+			replyLength = 0x0;
+		struct SDMSTResponseHeader response = {kSDMSTProtocolMagic, kSDMSTProtocolVersion, status, replyLength};
+		if (!SDMSTProtocolSendMessage(connection->fd, &response, sizeof(struct SDMSTResponseHeader), connection->response, replyLength))
+			break;
+	}
+	pthread_mutex_lock(&server->connectionLock);
+	for (uint32_t i = 0x0; i < server->connectionCount; i++)
+		if (server->connections[i] == connection->fd) {
+			server->connections[i] = server->connections[server->connectionCount - 0x1];
+			server->connectionCount--;
+			break;
+		}
+	close(connection->fd);
+	pthread_cond_broadcast(&server->connectionDrained);
+	pthread_mutex_unlock(&server->connectionLock);
+	free(connection->request);
+	free(connection->response);
+	free(connection->addresses);
+	free(connection->results);
+	free(connection);
+	return NULL;
+}
+
+bool SDMSTServerRun(struct SDMSTServer *server) {
+	struct sockaddr_un address;
+	memset(&address, 0x0, sizeof(struct sockaddr_un));
+	address.sun_family = AF_UNIX;
+	if (strlen(server->socketPath) >= sizeof(address.sun_path)) {
+		printf("[%s] Socket path is too long\n", server->socketPath);
+		return false;
+	}
+	strncpy(address.sun_path, server->socketPath, sizeof(address.sun_path) - 0x1);
+	server->listenFd = socket(AF_UNIX, SOCK_STREAM, 0x0);
+	if (server->listenFd < 0x0)
+		return false;
+	unlink(server->socketPath);
+	if (bind(server->listenFd, (struct sockaddr *)&address, sizeof(struct sockaddr_un)) || listen(server->listenFd, kSDMSTServerBacklog)) {
+		printf("[%s] Unable to listen: %s\n", server->socketPath, strerror(errno));
+		close(server->listenFd);
+		server->listenFd = -0x1;
+		return false;
+	}
+	while (__atomic_load_n(&server->running, __ATOMIC_ACQUIRE)) {
+		// Polling with a timeout lets SDMSTServerStop end the loop from any thread without signals.
+		struct pollfd listener = {server->listenFd, POLLIN, 0x0};
+		if (poll(&listener, 0x1, kSDMSTServerPollInterval) <= 0x0 || !(listener.revents & POLLIN))
+			continue;
+		int fd = accept(server->listenFd, NULL, NULL);
+		if (fd < 0x0)
+			continue;
+		SDMSTProtocolConfigureSocket(fd);
+		struct SDMSTServerConnection *connection = (struct SDMSTServerConnection *)calloc(0x1, sizeof(struct SDMSTServerConnection));
+		connection->server = server;
+		connection->fd = fd;
+		pthread_mutex_lock(&server->connectionLock);
+		server->connections = realloc(server->connections, sizeof(int)*(server->connectionCount+0x1));
+		server->connections[server->connectionCount] = fd;
+		server->connectionCount++;
+		pthread_mutex_unlock(&server->connectionLock);
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, SDMSTServerConnectionWorker, connection) == 0x0) {
+			pthread_detach(thread);
+		} else {
+			shutdown(fd, SHUT_RDWR);
+			SDMSTServerConnectionWorker(connection);
+		}
+	}
+	close(server->listenFd);
+	server->listenFd = -0x1;
+	unlink(server->socketPath);
+	pthread_mutex_lock(&server->connectionLock);
+	for (uint32_t i = 0x0; i < server->connectionCount; i++)
+		shutdown(server->connections[i], SHUT_RDWR);
+	while (server->connectionCount)
+		pthread_cond_wait(&server->connectionDrained, &server->connectionLock);
+	pthread_mutex_unlock(&server->connectionLock);
+	return true;
+}
+
+void SDMSTServerStop(struct SDMSTServer *server) {
+	__atomic_store_n(&server->running, false, __ATOMIC_RELEASE);
+}
+
+void SDMSTServerRelease(struct SDMSTServer *server) {
+	if (server) {
+		for (uint32_t i = 0x0; i < server->tableCount; i++) {
+			SDMSTLibraryRelease(server->tables[i]->libTable);
+			free(server->tables[i]->path);
+			free(server->tables[i]);
+		}
+		free(server->tables);
+		free(server->connections);
+		pthread_cond_destroy(&server->connectionDrained);
+		pthread_mutex_destroy(&server->connectionLock);
+		pthread_mutex_destroy(&server->loadLock);
+		pthread_rwlock_destroy(&server->tableLock);
+		free(server->socketPath);
+		free(server);
+	}
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ *  SDMSTServer.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSERVER_H_
+#define _SDMSTSERVER_H_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSymbolTable.h"
+#include "SDMSTProtocol.h"
+#include <pthread.h>
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTServerPollInterval 0xfa
+#define kSDMSTServerBacklog 0x80
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTServerTable {
+	char *path;
+	uint8_t uuid[kSDMSTProtocolUUIDSize];
+	struct SDMMOLibrarySymbolTable *libTable;
+	uint64_t textAddress;
+	uint64_t textSize;
+} SDMSTServerTable;
+
+typedef struct SDMSTServer {
+	char *socketPath;
+	int listenFd;
+	bool running;
+	pthread_rwlock_t tableLock;
+	pthread_mutex_t loadLock;
+	struct SDMSTServerTable **tables;
+	uint32_t tableCount;
+	pthread_mutex_t connectionLock;
+	pthread_cond_t connectionDrained;
+	int *connections;
+	uint32_t connectionCount;
+} SDMSTServer;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTServer* SDMSTServerCreate(char *socketPath);
+uint16_t SDMSTServerRegister(struct SDMSTServer *server, char *path, uint8_t *expectedUUID, uint32_t *tableId);
+bool SDMSTServerRun(struct SDMSTServer *server);
+void SDMSTServerStop(struct SDMSTServer *server);
+void SDMSTServerRelease(struct SDMSTServer *server);
+
+#endif
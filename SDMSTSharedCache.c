@@ -0,0 +1,318 @@
+/*
+ *  SDMSTSharedCache.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSHAREDCACHE_C_
+#define _SDMSTSHAREDCACHE_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTSharedCache.h"
+#include "SDMMachO.h"
+#include "SDMSTCommandIndex.h"
+#include "SDMSTPerfectHash.h"
+#include "SDMSTWorkers.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTSharedCacheImageKey {
+	uint64_t key;
+	uint32_t image;
+} SDMSTSharedCacheImageKey;
+
+typedef struct SDMSTSharedCacheBatch {
+	struct SDMSTSharedCache *cache;
+	uint32_t next;
+	uint32_t indexed;
+} SDMSTSharedCacheBatch;
+
+#pragma mark -
+#pragma mark Declarations
+
+int SDMSTCompareSharedCacheImageKeys(const void *entry1, const void *entry2);
+bool SDMSTSharedCacheRead(int fd, uint64_t fileSize, void *buffer, uint64_t size, uint64_t offset);
+uint64_t SDMSTSharedCacheFileOffset(struct SDMSTSharedCache *cache, uint64_t address);
+void SDMSTSharedCacheReadLocalSymbols(struct SDMSTSharedCache *cache, int fd, bool is64bit);
+void SDMSTSharedCacheIndexPaths(struct SDMSTSharedCache *cache);
+bool SDMSTSharedCacheLinkeditInFile(struct SDMSTSharedCache *cache, struct SDMSTSharedCacheImage *entry);
+void* SDMSTSharedCacheIndexWorker(void *context);
+
+#pragma mark -
+#pragma mark Functions
+
+int SDMSTCompareSharedCacheImageKeys(const void *entry1, const void *entry2) {
+	const struct SDMSTSharedCacheImageKey *key1 = (const struct SDMSTSharedCacheImageKey *)entry1;
+	const struct SDMSTSharedCacheImageKey *key2 = (const struct SDMSTSharedCacheImageKey *)entry2;
+	return (key1->key < key2->key ? -1 : (key1->key > key2->key ? 1 : 0));
+}
+
+bool SDMSTSharedCacheRead(int fd, uint64_t fileSize, void *buffer, uint64_t size, uint64_t offset) {
+	return (offset <= fileSize && size <= fileSize - offset && pread(fd, buffer, (size_t)size, (off_t)offset) == (ssize_t)size);
+}
+
+uint64_t SDMSTSharedCacheFileOffset(struct SDMSTSharedCache *cache, uint64_t address) {
+	for (uint32_t i = 0x0; i < cache->mappingCount; i++) {
+		if (address >= cache->mappings[i].address && address - cache->mappings[i].address < cache->mappings[i].size)
+			return cache->mappings[i].fileOffset + (address - cache->mappings[i].address);
+	}
+	return UINT64_MAX;
+}
+
+void SDMSTSharedCacheReadLocalSymbols(struct SDMSTSharedCache *cache, int fd, bool is64bit) {
+	// Private names are stripped from each image's own symbol table and kept in one nlist/string pool for the whole cache,
+	// with an entry per image giving its run of nlists. Newer caches key entries by the image's offset from the start of
+	// the cache's address range and use 64-bit keys; older ones key them by the file offset of the image's header.
+	struct SDMSTSharedCacheLocalSymbolsInfo info;
+	uint64_t base = cache->header.localSymbolsOffset;
+	if (base == 0x0 || base > cache->size || cache->header.localSymbolsSize > cache->size - base || cache->header.localSymbolsSize < sizeof(info) || !SDMSTSharedCacheRead(fd, cache->size, &info, sizeof(info), base))
+		return;
+	bool wideEntries = (cache->header.mappingOffset >= kSDMSTSharedCacheSymbolFileUUIDField);
+	uint64_t entrySize = (wideEntries ? sizeof(struct SDMSTSharedCacheLocalSymbolsEntry64) : sizeof(struct SDMSTSharedCacheLocalSymbolsEntry));
+	uint64_t nlistSize = sizeof(struct SDMSTSymbolTableListEntry) + (is64bit ? sizeof(uint64_t) : sizeof(uint32_t));
+	if ((uint64_t)info.entriesOffset + (uint64_t)info.entriesCount * entrySize > cache->header.localSymbolsSize || (uint64_t)info.stringsOffset + info.stringsSize > cache->header.localSymbolsSize)
+		return;
+	uint8_t *entries = (uint8_t *)calloc((size_t)(info.entriesCount * entrySize + 0x1), sizeof(uint8_t));
+	struct SDMSTSharedCacheImageKey *keys = (struct SDMSTSharedCacheImageKey *)calloc(cache->imageCount + 0x1, sizeof(struct SDMSTSharedCacheImageKey));
+	uint64_t cacheStart = (cache->mappingCount ? cache->mappings[0x0].address : 0x0);
+	for (uint32_t i = 0x0; i < cache->imageCount; i++)
+		keys[i] = (struct SDMSTSharedCacheImageKey){(wideEntries ? cache->images[i].address - cacheStart : cache->images[i].fileOffset), i};
+	qsort(keys, cache->imageCount, sizeof(struct SDMSTSharedCacheImageKey), SDMSTCompareSharedCacheImageKeys);
+	if (SDMSTSharedCacheRead(fd, cache->size, entries, info.entriesCount * entrySize, base + info.entriesOffset)) {
+		for (uint32_t i = 0x0; i < info.entriesCount; i++) {
+			struct SDMSTSharedCacheImageKey key = {0x0, 0x0};
+			uint32_t start, count;
+			if (wideEntries) {
+				struct SDMSTSharedCacheLocalSymbolsEntry64 *entry = (struct SDMSTSharedCacheLocalSymbolsEntry64 *)(entries + i * entrySize);
+				key.key = entry->dylibOffset;
+				start = entry->nlistStartIndex;
+				count = entry->nlistCount;
+			} else {
+				struct SDMSTSharedCacheLocalSymbolsEntry *entry = (struct SDMSTSharedCacheLocalSymbolsEntry *)(entries + i * entrySize);
+				key.key = entry->dylibOffset;
+				start = entry->nlistStartIndex;
+				count = entry->nlistCount;
+			}
+			struct SDMSTSharedCacheImageKey *match = bsearch(&key, keys, cache->imageCount, sizeof(struct SDMSTSharedCacheImageKey), SDMSTCompareSharedCacheImageKeys);
+			// Offsets in the synthetic LC_SYMTAB are relative to the local symbols region rather than the cache, so they stay
+			// within 32 bits wherever in the file that region sits.
+			uint64_t symbolsOffset = info.nlistOffset + (uint64_t)start * nlistSize;
+			if (match && (uint64_t)start + count <= info.nlistCount && symbolsOffset + (uint64_t)count * nlistSize <= cache->header.localSymbolsSize && symbolsOffset <= UINT32_MAX)
+				cache->images[match->image].localSymbols = (struct symtab_command){LC_SYMTAB, sizeof(struct symtab_command), (uint32_t)symbolsOffset, count, info.stringsOffset, info.stringsSize};
+		}
+	}
+	free(keys);
+	free(entries);
+}
+
+void SDMSTSharedCacheIndexPaths(struct SDMSTSharedCache *cache) {
+	// Open addressing on install names, built once so finding an image by path does not walk the whole image list; the
+	// first image listed with a given path is the one found.
+	uint32_t slotCount = 0x2;
+	while (slotCount < cache->imageCount * 0x2)
+		slotCount <<= 0x1;
+	cache->pathSlotMask = slotCount - 0x1;
+	cache->pathSlots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+	for (uint32_t i = 0x0; i < cache->imageCount; i++) {
+		if (SDMSTSharedCacheFindImage(cache, cache->images[i].path) != kSDMSTSharedCacheNotFound)
+			continue;
+		uint32_t slot = (uint32_t)SDMSTHashName(cache->images[i].path, strlen(cache->images[i].path), 0x0) & cache->pathSlotMask;
+		while (cache->pathSlots[slot])
+			slot = (slot + 0x1) & cache->pathSlotMask;
+		cache->pathSlots[slot] = i + 0x1;
+	}
+}
+
+struct SDMSTSharedCache* SDMSTSharedCacheOpen(const char *path) {
+	// Only the cache's own tables are read up front; an image's symbol table is built the first time it is asked for.
+	int fd = (path ? open(path, O_RDONLY) : -0x1);
+	struct stat fs;
+	if (fd < 0x0)
+		return NULL;
+	struct SDMSTSharedCache *cache = (struct SDMSTSharedCache *)calloc(0x1, sizeof(struct SDMSTSharedCache));
+	bool valid = (fstat(fd, &fs) == 0x0);
+	cache->size = (valid ? (uint64_t)fs.st_size : 0x0);
+	valid = valid && SDMSTSharedCacheRead(fd, cache->size, &(cache->header), sizeof(struct SDMSTSharedCacheHeader), 0x0);
+	valid = valid && !strncmp(cache->header.magic, kSDMSTSharedCacheMagic, strlen(kSDMSTSharedCacheMagic));
+	valid = valid && cache->header.mappingOffset >= sizeof(struct SDMSTSharedCacheHeader) && cache->header.mappingCount && cache->header.mappingCount <= kSDMSTSharedCacheMaximumMappings;
+	if (valid) {
+		cache->mappingCount = cache->header.mappingCount;
+		cache->mappings = (struct SDMSTSharedCacheMapping *)calloc(cache->mappingCount, sizeof(struct SDMSTSharedCacheMapping));
+		valid = SDMSTSharedCacheRead(fd, cache->size, cache->mappings, cache->mappingCount * sizeof(struct SDMSTSharedCacheMapping), cache->header.mappingOffset);
+	}
+	// A split cache lists its sub-cache files here. Only what lies in this file is read, so images whose segments live in a
+	// sub-cache are turned away when their table is asked for.
+	if (valid && cache->header.mappingOffset >= kSDMSTSharedCacheSubCacheCountField + sizeof(uint32_t))
+		SDMSTSharedCacheRead(fd, cache->size, &(cache->subCacheCount), sizeof(uint32_t), kSDMSTSharedCacheSubCacheCountField);
+	uint32_t images[0x2] = {cache->header.imagesOffsetOld, cache->header.imagesCountOld};
+	if (valid && cache->header.mappingOffset >= kSDMSTSharedCacheImagesField + sizeof(images)) {
+		uint32_t current[0x2];
+		if (SDMSTSharedCacheRead(fd, cache->size, current, sizeof(current), kSDMSTSharedCacheImagesField) && current[0x1]) {
+			images[0x0] = current[0x0];
+			images[0x1] = current[0x1];
+		}
+	}
+	if (valid && images[0x1]) {
+		struct SDMSTSharedCacheImageInfo *infos = (struct SDMSTSharedCacheImageInfo *)calloc(images[0x1], sizeof(struct SDMSTSharedCacheImageInfo));
+		if (SDMSTSharedCacheRead(fd, cache->size, infos, (uint64_t)images[0x1] * sizeof(struct SDMSTSharedCacheImageInfo), images[0x0])) {
+			char *pathBuffer = (char *)calloc(kSDMSTSharedCacheMaximumPath + 0x1, sizeof(char));
+			cache->images = (struct SDMSTSharedCacheImage *)calloc(images[0x1], sizeof(struct SDMSTSharedCacheImage));
+			cache->imageCount = images[0x1];
+			for (uint32_t i = 0x0; i < cache->imageCount; i++) {
+				uint64_t pathSize = (infos[i].pathFileOffset < cache->size ? cache->size - infos[i].pathFileOffset : 0x0);
+				pathSize = (pathSize > kSDMSTSharedCacheMaximumPath ? kSDMSTSharedCacheMaximumPath : pathSize);
+				memset(pathBuffer, 0x0, kSDMSTSharedCacheMaximumPath);
+				SDMSTSharedCacheRead(fd, cache->size, pathBuffer, pathSize, infos[i].pathFileOffset);
+				cache->images[i].path = strdup(pathBuffer);
+				cache->images[i].address = infos[i].address;
+				// Images that live in a sub-cache file have no range in this file's mappings and cannot be indexed from it.
+				cache->images[i].fileOffset = SDMSTSharedCacheFileOffset(cache, infos[i].address);
+			}
+			free(pathBuffer);
+			SDMSTSharedCacheIndexPaths(cache);
+		}
+		free(infos);
+	}
+	if (valid && cache->imageCount) {
+		uint32_t magic = 0x0;
+		for (uint32_t i = 0x0; i < cache->imageCount && magic == 0x0; i++) {
+			if (cache->images[i].fileOffset != UINT64_MAX)
+				SDMSTSharedCacheRead(fd, cache->size, &magic, sizeof(magic), cache->images[i].fileOffset);
+		}
+		SDMSTSharedCacheReadLocalSymbols(cache, fd, (magic == MH_MAGIC_64));
+	}
+	if (valid) {
+		// Same layout as a mapped slice: the whole file is reserved and pages are mapped in as images touch them.
+		uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+		void* reservation = (cache->size && cache->size <= SIZE_MAX ? mmap(NULL, (size_t)cache->size, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0x0) : MAP_FAILED);
+		valid = (reservation != MAP_FAILED);
+		if (valid) {
+			cache->base = reservation;
+			cache->mapping = (struct SDMSTLibraryMapping *)calloc(0x1, sizeof(struct SDMSTLibraryMapping));
+			cache->mapping->fd = fd;
+			cache->mapping->pageSize = pageSize;
+			cache->mapping->pages = (uint8_t *)calloc((size_t)((cache->size / pageSize + 0x8) >> 0x3), sizeof(uint8_t));
+			cache->path = strdup(path);
+		}
+	}
+	if (!valid) {
+		close(fd);
+		SDMSTSharedCacheRelease(cache);
+		cache = NULL;
+	}
+	return cache;
+}
+
+bool SDMSTSharedCacheLinkeditInFile(struct SDMSTSharedCache *cache, struct SDMSTSharedCacheImage *entry) {
+	// Symbol offsets are file offsets into the cache the image's __LINKEDIT was laid out in. When that segment was placed
+	// in a sub-cache, the same offsets in this file point at unrelated data, so the image is only read if its __LINKEDIT
+	// address maps back to the segment's own file offset here.
+	bool inFile = false;
+	struct mach_header_64 header;
+	if (SDMSTSharedCacheRead(cache->mapping->fd, cache->size, &header, sizeof(struct mach_header_64), entry->fileOffset)) {
+		uint64_t commandsSize = SDMSTImageCommandsSize((struct mach_header *)&header);
+		char *commands = (commandsSize ? (char *)calloc((size_t)commandsSize, sizeof(char)) : NULL);
+		if (commands && SDMSTSharedCacheRead(cache->mapping->fd, cache->size, commands, commandsSize, entry->fileOffset)) {
+			struct SDMSTCommandIndex *index = SDMSTCommandIndexCreate((struct mach_header *)commands, commandsSize);
+			struct SDMSTSegmentInfo *linkSegment = SDMSTSegmentNamed(index, SEG_LINKEDIT);
+			inFile = (linkSegment && SDMSTSharedCacheFileOffset(cache, linkSegment->vmaddr) == linkSegment->fileoff && linkSegment->fileoff <= cache->size && linkSegment->filesize <= cache->size - linkSegment->fileoff);
+			SDMSTCommandIndexRelease(index);
+		}
+		free(commands);
+	}
+	return inFile;
+}
+
+uint32_t SDMSTSharedCacheFindImage(struct SDMSTSharedCache *cache, const char *path) {
+	if (cache == NULL || path == NULL || cache->pathSlots == NULL)
+		return kSDMSTSharedCacheNotFound;
+	for (uint32_t slot = (uint32_t)SDMSTHashName(path, strlen(path), 0x0) & cache->pathSlotMask; cache->pathSlots[slot]; slot = (slot + 0x1) & cache->pathSlotMask) {
+		if (!strcmp(cache->images[cache->pathSlots[slot] - 0x1].path, path))
+			return cache->pathSlots[slot] - 0x1;
+	}
+	return kSDMSTSharedCacheNotFound;
+}
+
+struct SDMMOLibrarySymbolTable* SDMSTSharedCacheImageTable(struct SDMSTSharedCache *cache, uint32_t image) {
+	// Two threads asking for the same image at once may both build it; the first to publish wins and the other is dropped.
+	if (cache == NULL || image >= cache->imageCount || cache->images[image].fileOffset == UINT64_MAX)
+		return NULL;
+	struct SDMMOLibrarySymbolTable *table = __atomic_load_n(&(cache->images[image].table), __ATOMIC_ACQUIRE);
+	if (table == NULL) {
+		struct SDMSTSharedCacheImage *entry = &(cache->images[image]);
+		if (!SDMSTSharedCacheLinkeditInFile(cache, entry))
+			return NULL;
+		table = SDMSTLoadMappedImage(entry->path, (char*)cache->base + entry->fileOffset, cache->base, cache->base, cache->size, cache->mapping, (entry->localSymbols.nsyms ? &(entry->localSymbols) : NULL), (char*)cache->base + cache->header.localSymbolsOffset);
+		if (table->loadStatus != kSDMSTLoadOK) {
+			SDMSTLibraryRelease(table);
+			return NULL;
+		}
+		struct SDMMOLibrarySymbolTable *expected = NULL;
+		if (!__atomic_compare_exchange_n(&(entry->table), &expected, table, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			SDMSTLibraryRelease(table);
+			table = expected;
+		}
+	}
+	return table;
+}
+
+void* SDMSTSharedCacheIndexWorker(void *context) {
+	struct SDMSTSharedCacheBatch *batch = (struct SDMSTSharedCacheBatch *)context;
+	for (uint32_t image = __atomic_fetch_add(&batch->next, 0x1, __ATOMIC_RELAXED); image < batch->cache->imageCount; image = __atomic_fetch_add(&batch->next, 0x1, __ATOMIC_RELAXED)) {
+		if (SDMSTSharedCacheImageTable(batch->cache, image))
+			__atomic_fetch_add(&batch->indexed, 0x1, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+uint32_t SDMSTSharedCacheIndexImages(struct SDMSTSharedCache *cache, uint32_t threadCount) {
+	if (cache == NULL || cache->imageCount == 0x0)
+		return 0x0;
+	struct SDMSTSharedCacheBatch batch = {cache, 0x0, 0x0};
+	// Everything comes from one mapped file, so the work is parsing and sorting and the default of one worker per core fits.
+	SDMSTRunWorkers(threadCount, cache->imageCount, SDMSTSharedCacheIndexWorker, &batch);
+	return batch.indexed;
+}
+
+void SDMSTSharedCacheRelease(struct SDMSTSharedCache *cache) {
+	if (cache) {
+		for (uint32_t i = 0x0; i < cache->imageCount; i++) {
+			if (cache->images[i].table)
+				SDMSTLibraryRelease(cache->images[i].table);
+			free(cache->images[i].path);
+		}
+		free(cache->images);
+		free(cache->pathSlots);
+		free(cache->mappings);
+		if (cache->base)
+			munmap(cache->base, (size_t)cache->size);
+		if (cache->mapping) {
+			close(cache->mapping->fd);
+			free(cache->mapping->pages);
+			free(cache->mapping);
+		}
+		free(cache->path);
+		free(cache);
+	}
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ *  SDMSTSharedCache.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSHAREDCACHE_H_
+#define _SDMSTSHAREDCACHE_H_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSymbolTable.h"
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTSharedCacheMagic "dyld_v1"
+#define kSDMSTSharedCacheImagesField 0x1c0
+#define kSDMSTSharedCacheSubCacheCountField 0x18c
+#define kSDMSTSharedCacheSymbolFileUUIDField 0x190
+#define kSDMSTSharedCacheMaximumMappings 0x20
+#define kSDMSTSharedCacheMaximumPath 0x400
+#define kSDMSTSharedCacheNotFound 0xffffffff
+
+#pragma mark -
+#pragma mark Types
+
+// The fixed prefix of dyld_cache_header every cache version shares; later fields are read at their own offsets once
+// mappingOffset, which doubles as the header size, shows they are present.
+typedef struct SDMSTSharedCacheHeader {
+	char magic[0x10];
+	uint32_t mappingOffset;
+	uint32_t mappingCount;
+	uint32_t imagesOffsetOld;
+	uint32_t imagesCountOld;
+	uint64_t dyldBaseAddress;
+	uint64_t codeSignatureOffset;
+	uint64_t codeSignatureSize;
+	uint64_t slideInfoOffset;
+	uint64_t slideInfoSize;
+	uint64_t localSymbolsOffset;
+	uint64_t localSymbolsSize;
+	uint8_t uuid[0x10];
+} __attribute__ ((packed)) SDMSTSharedCacheHeader;
+
+typedef struct SDMSTSharedCacheMapping {
+	uint64_t address;
+	uint64_t size;
+	uint64_t fileOffset;
+	uint32_t maxProt;
+	uint32_t initProt;
+} __attribute__ ((packed)) SDMSTSharedCacheMapping;
+
+typedef struct SDMSTSharedCacheImageInfo {
+	uint64_t address;
+	uint64_t modTime;
+	uint64_t inode;
+	uint32_t pathFileOffset;
+	uint32_t pad;
+} __attribute__ ((packed)) SDMSTSharedCacheImageInfo;
+
+typedef struct SDMSTSharedCacheLocalSymbolsInfo {
+	uint32_t nlistOffset;
+	uint32_t nlistCount;
+	uint32_t stringsOffset;
+	uint32_t stringsSize;
+	uint32_t entriesOffset;
+	uint32_t entriesCount;
+} __attribute__ ((packed)) SDMSTSharedCacheLocalSymbolsInfo;
+
+typedef struct SDMSTSharedCacheLocalSymbolsEntry {
+	uint32_t dylibOffset;
+	uint32_t nlistStartIndex;
+	uint32_t nlistCount;
+} __attribute__ ((packed)) SDMSTSharedCacheLocalSymbolsEntry;
+
+typedef struct SDMSTSharedCacheLocalSymbolsEntry64 {
+	uint64_t dylibOffset;
+	uint32_t nlistStartIndex;
+	uint32_t nlistCount;
+} __attribute__ ((packed)) SDMSTSharedCacheLocalSymbolsEntry64;
+
+typedef struct SDMSTSharedCacheImage {
+	char *path;
+	uint64_t address;
+	uint64_t fileOffset;
+	struct symtab_command localSymbols;
+	struct SDMMOLibrarySymbolTable *table;
+} SDMSTSharedCacheImage;
+
+typedef struct SDMSTSharedCache {
+	char *path;
+	uint64_t size;
+	void* base;
+	struct SDMSTLibraryMapping *mapping;
+	struct SDMSTSharedCacheHeader header;
+	struct SDMSTSharedCacheMapping *mappings;
+	uint32_t mappingCount;
+	struct SDMSTSharedCacheImage *images;
+	uint32_t imageCount;
+	uint32_t *pathSlots;
+	uint32_t pathSlotMask;
+	uint32_t subCacheCount;
+} SDMSTSharedCache;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTSharedCache* SDMSTSharedCacheOpen(const char *path);
+uint32_t SDMSTSharedCacheFindImage(struct SDMSTSharedCache *cache, const char *path);
+struct SDMMOLibrarySymbolTable* SDMSTSharedCacheImageTable(struct SDMSTSharedCache *cache, uint32_t image);
+uint32_t SDMSTSharedCacheIndexImages(struct SDMSTSharedCache *cache, uint32_t threadCount);
+void SDMSTSharedCacheRelease(struct SDMSTSharedCache *cache);
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ *  SDMSTSharedIndex.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSHAREDINDEX_C_
+#define _SDMSTSHAREDINDEX_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTSharedIndex.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#pragma mark -
+#pragma mark Declarations
+
+uint64_t SDMSTSharedIndexGeneration(const char *name);
+
+#pragma mark -
+#pragma mark Functions
+
+uint64_t SDMSTSharedIndexGeneration(const char *name) {
+	uint64_t generation = 0x0;
+	struct SDMSTSharedIndex *previous = SDMSTSharedIndexAttach(name);
+	if (previous) {
+		generation = previous->image->header->generation;
+		SDMSTSharedIndexDetach(previous);
+	}
+	return generation;
+}
+
+bool SDMSTSharedIndexPublish(struct SDMMOLibrarySymbolTable *libTable, const char *name) {
+	bool published = false;
+	uint64_t size = SDMSTIndexImageSize(libTable);
+	if (size == 0x0 || name == NULL)
+		return false;
+	uint64_t generation = SDMSTSharedIndexGeneration(name) + 0x1;
+	// A published segment is never rewritten in place: the old name is unlinked and a fresh object built under it, so
+	// processes still attached to the previous generation keep a consistent mapping until they detach.
+	shm_unlink(name);
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0x0)
+		return false;
+	if (ftruncate(fd, (off_t)size) == 0x0) {
+		void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0x0);
+		if (mapping != MAP_FAILED) {
+			if (SDMSTIndexImageWrite(libTable, mapping, size, generation)) {
+				SDMSTIndexImagePublish(mapping);
+				published = true;
+			}
+			munmap(mapping, size);
+		}
+	}
+	close(fd);
+	if (!published)
+		shm_unlink(name);
+	return published;
+}
+
+struct SDMSTSharedIndex* SDMSTSharedIndexAttach(const char *name) {
+	struct SDMSTSharedIndex *sharedIndex = NULL;
+	int fd = (name ? shm_open(name, O_RDONLY, 0x0) : -0x1);
+	if (fd < 0x0)
+		return NULL;
+	struct stat fs;
+	if (fstat(fd, &fs) == 0x0 && fs.st_size > 0x0) {
+		void *mapping = mmap(NULL, (size_t)fs.st_size, PROT_READ, MAP_SHARED, fd, 0x0);
+		if (mapping != MAP_FAILED) {
+			struct SDMSTIndexImage *image = SDMSTIndexImageCreateFromBuffer(mapping, (uint64_t)fs.st_size, false);
+			if (image) {
+				sharedIndex = (struct SDMSTSharedIndex *)calloc(0x1, sizeof(struct SDMSTSharedIndex));
+				sharedIndex->name = strdup(name);
+				sharedIndex->mapping = mapping;
+				sharedIndex->mappingSize = (uint64_t)fs.st_size;
+				sharedIndex->image = image;
+			} else {
+				munmap(mapping, (size_t)fs.st_size);
+			}
+		}
+	}
+	close(fd);
+	return sharedIndex;
+}
+
+bool SDMSTSharedIndexUnlink(const char *name) {
+	return (name && shm_unlink(name) == 0x0);
+}
+
+void SDMSTSharedIndexDetach(struct SDMSTSharedIndex *sharedIndex) {
+	if (sharedIndex) {
+		SDMSTIndexImageRelease(sharedIndex->image);
+		munmap(sharedIndex->mapping, sharedIndex->mappingSize);
+		free(sharedIndex->name);
+		free(sharedIndex);
+	}
+}
+
+#endif
@@ -0,0 +1,235 @@
+/*
+ *  SDMSTString.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSTRING_C_
+#define _SDMSTSTRING_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTString.h"
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SDMST_STRING_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#pragma mark -
+#pragma mark Declarations
+
+uint64_t SDMSTStringLengthScalar(const char *string);
+bool SDMSTStringEqualScalar(const char *string1, const char *string2, uint64_t length);
+#if SDMST_STRING_X86
+uint64_t SDMSTStringLengthSSE2(const char *string);
+bool SDMSTStringEqualSSE2(const char *string1, const char *string2, uint64_t length);
+uint64_t SDMSTStringLengthAVX2(const char *string);
+bool SDMSTStringEqualAVX2(const char *string1, const char *string2, uint64_t length);
+#endif
+bool SDMSTStringVariantSupported(SDMSTStringVariant variant);
+void SDMSTStringSelectKernels();
+
+#pragma mark -
+#pragma mark Variables
+
+static const struct SDMSTStringKernels kSDMSTStringKernels[SDMSTStringVariantCount] = {
+	{SDMSTStringVariantScalar, "scalar", SDMSTStringLengthScalar, SDMSTStringEqualScalar},
+#if SDMST_STRING_X86
+	{SDMSTStringVariantSSE2, "sse2", SDMSTStringLengthSSE2, SDMSTStringEqualSSE2},
+	{SDMSTStringVariantAVX2, "avx2", SDMSTStringLengthAVX2, SDMSTStringEqualAVX2}
+#else
+	{SDMSTStringVariantSSE2, "sse2", NULL, NULL},
+	{SDMSTStringVariantAVX2, "avx2", NULL, NULL}
+#endif
+};
+
+static pthread_once_t kSDMSTStringKernelsOnce = PTHREAD_ONCE_INIT;
+static const struct SDMSTStringKernels *kSDMSTStringKernelsActive = &kSDMSTStringKernels[SDMSTStringVariantScalar];
+
+#pragma mark -
+#pragma mark Scalar
+
+uint64_t SDMSTStringLengthScalar(const char *string) {
+	const char *end = string;
+	while (*end)
+		end++;
+	return (uint64_t)(end - string);
+}
+
+bool SDMSTStringEqualScalar(const char *string1, const char *string2, uint64_t length) {
+	while (length >= sizeof(uint64_t)) {
+		uint64_t word1, word2;
+		memcpy(&word1, string1, sizeof(uint64_t));
+		memcpy(&word2, string2, sizeof(uint64_t));
+		if (word1 != word2)
+			return false;
+		string1 += sizeof(uint64_t);
+		string2 += sizeof(uint64_t);
+		length -= sizeof(uint64_t);
+	}
+	while (length) {
+		if (*string1++ != *string2++)
+			return false;
+		length--;
+	}
+	return true;
+}
+
+#if SDMST_STRING_X86
+#pragma mark -
+#pragma mark SSE2
+
+// The length kernels only issue aligned loads, which can never cross into an unmapped page, so reading the bytes ahead of the string start is safe.
+__attribute__((target("sse2"), no_sanitize_address))
+uint64_t SDMSTStringLengthSSE2(const char *string) {
+	const __m128i zero = _mm_setzero_si128();
+	uintptr_t misalign = (uintptr_t)string & 0xf;
+	const __m128i *block = (const __m128i *)(string - misalign);
+	uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block), zero)) >> misalign;
+	if (mask)
+		return __builtin_ctz(mask);
+	while (true) {
+		block++;
+		mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block), zero));
+		if (mask)
+			return (uint64_t)(((const char *)block + __builtin_ctz(mask)) - string);
+	}
+}
+
+__attribute__((target("sse2")))
+bool SDMSTStringEqualSSE2(const char *string1, const char *string2, uint64_t length) {
+	if (length < 0x10)
+		return SDMSTStringEqualScalar(string1, string2, length);
+	uint64_t offset = 0x0;
+	for (; offset + 0x10 <= length; offset += 0x10) {
+		__m128i block1 = _mm_loadu_si128((const __m128i *)(string1 + offset));
+		__m128i block2 = _mm_loadu_si128((const __m128i *)(string2 + offset));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(block1, block2)) != 0xffff)
+			return false;
+	}
+	if (offset < length) {
+		__m128i block1 = _mm_loadu_si128((const __m128i *)(string1 + length - 0x10));
+		__m128i block2 = _mm_loadu_si128((const __m128i *)(string2 + length - 0x10));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(block1, block2)) != 0xffff)
+			return false;
+	}
+	return true;
+}
+
+#pragma mark -
+#pragma mark AVX2
+
+__attribute__((target("avx2"), no_sanitize_address))
+uint64_t SDMSTStringLengthAVX2(const char *string) {
+	const __m256i zero = _mm256_setzero_si256();
+	uintptr_t misalign = (uintptr_t)string & 0x1f;
+	const __m256i *block = (const __m256i *)(string - misalign);
+	uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(block), zero)) >> misalign;
+	if (mask)
+		return __builtin_ctz(mask);
+	while (true) {
+		block++;
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(block), zero));
+		if (mask)
+			return (uint64_t)(((const char *)block + __builtin_ctz(mask)) - string);
+	}
+}
+
+__attribute__((target("avx2")))
+bool SDMSTStringEqualAVX2(const char *string1, const char *string2, uint64_t length) {
+	if (length < 0x20)
+		return SDMSTStringEqualSSE2(string1, string2, length);
+	uint64_t offset = 0x0;
+	for (; offset + 0x20 <= length; offset += 0x20) {
+		__m256i block1 = _mm256_loadu_si256((const __m256i *)(string1 + offset));
+		__m256i block2 = _mm256_loadu_si256((const __m256i *)(string2 + offset));
+		if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block1, block2)) != 0xffffffff)
+			return false;
+	}
+	if (offset < length) {
+		__m256i block1 = _mm256_loadu_si256((const __m256i *)(string1 + length - 0x20));
+		__m256i block2 = _mm256_loadu_si256((const __m256i *)(string2 + length - 0x20));
+		if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block1, block2)) != 0xffffffff)
+			return false;
+	}
+	return true;
+}
+#endif
+
+#pragma mark -
+#pragma mark Dispatch
+
+bool SDMSTStringVariantSupported(SDMSTStringVariant variant) {
+	bool supported = (variant == SDMSTStringVariantScalar);
+#if SDMST_STRING_X86
+	uint32_t eax = 0x0, ebx = 0x0, ecx = 0x0, edx = 0x0;
+	if (__get_cpuid(0x1, &eax, &ebx, &ecx, &edx)) {
+		if (variant == SDMSTStringVariantSSE2) {
+			supported = ((edx & bit_SSE2) != 0x0);
+		} else if (variant == SDMSTStringVariantAVX2) {
+			// AVX2 also needs the OS to save the YMM state (OSXSAVE plus XCR0 bits 1 and 2).
+			if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+				uint32_t xcr0Low = 0x0, xcr0High = 0x0;
+				__asm__ volatile ("xgetbv" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0x0));
+				if ((xcr0Low & 0x6) == 0x6 && __get_cpuid_max(0x0, NULL) >= 0x7) {
+					__cpuid_count(0x7, 0x0, eax, ebx, ecx, edx);
+					supported = ((ebx & bit_AVX2) != 0x0);
+				}
+			}
+		}
+	}
+#endif
+	return supported;
+}
+
+void SDMSTStringSelectKernels() {
+	for (int32_t variant = SDMSTStringVariantCount - 1; variant >= SDMSTStringVariantScalar; variant--) {
+		if (SDMSTStringVariantSupported((SDMSTStringVariant)variant)) {
+			kSDMSTStringKernelsActive = &kSDMSTStringKernels[variant];
+			break;
+		}
+	}
+}
+
+const struct SDMSTStringKernels* SDMSTStringKernelsActive() {
+	pthread_once(&kSDMSTStringKernelsOnce, SDMSTStringSelectKernels);
+	return kSDMSTStringKernelsActive;
+}
+
+const struct SDMSTStringKernels* SDMSTStringKernelsForVariant(SDMSTStringVariant variant) {
+	if (variant < SDMSTStringVariantCount && SDMSTStringVariantSupported(variant))
+		return &kSDMSTStringKernels[variant];
+	return NULL;
+}
+
+uint64_t SDMSTStringLength(const char *string) {
+	return SDMSTStringKernelsActive()->length(string);
+}
+
+bool SDMSTStringEqual(const char *string1, const char *string2, uint64_t length) {
+	return SDMSTStringKernelsActive()->equal(string1, string2, length);
+}
+
+bool SDMSTStringHasSuffix(const char *string, uint64_t stringLength, const char *suffix, uint64_t suffixLength) {
+	if (suffixLength > stringLength)
+		return false;
+	return SDMSTStringKernelsActive()->equal(string + (stringLength - suffixLength), suffix, suffixLength);
+}
+
+#endif
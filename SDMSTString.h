@@ -0,0 +1,56 @@
+/*
+ *  SDMSTString.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSTRING_H_
+#define _SDMSTSTRING_H_
+
+#pragma mark -
+#pragma mark Includes
+#include <stdint.h>
+#include <stdbool.h>
+
+#pragma mark -
+#pragma mark Types
+
+typedef enum SDMSTStringVariant {
+	SDMSTStringVariantScalar = 0,
+	SDMSTStringVariantSSE2 = 1,
+	SDMSTStringVariantAVX2 = 2,
+	SDMSTStringVariantCount = 3
+} SDMSTStringVariant;
+
+typedef uint64_t (*SDMSTStringLengthCall)(const char *string);
+typedef bool (*SDMSTStringEqualCall)(const char *string1, const char *string2, uint64_t length);
+
+typedef struct SDMSTStringKernels {
+	SDMSTStringVariant variant;
+	const char *name;
+	SDMSTStringLengthCall length;
+	SDMSTStringEqualCall equal;
+} SDMSTStringKernels;
+
+#pragma mark -
+#pragma mark Declarations
+
+const struct SDMSTStringKernels* SDMSTStringKernelsActive();
+const struct SDMSTStringKernels* SDMSTStringKernelsForVariant(SDMSTStringVariant variant);
+uint64_t SDMSTStringLength(const char *string);
+bool SDMSTStringEqual(const char *string1, const char *string2, uint64_t length);
+bool SDMSTStringHasSuffix(const char *string, uint64_t stringLength, const char *suffix, uint64_t suffixLength);
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ *  SDMSTStubIndex.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSTUBINDEX_C_
+#define _SDMSTSTUBINDEX_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTStubIndex.h"
+#include "SDMMachO.h"
+#include "SDMSTCommandIndex.h"
+#include <string.h>
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTStubSection {
+	uintptr_t address;
+	uint32_t slotCount;
+	uint32_t stride;
+	uint32_t kind;
+	uint32_t firstIndirect;
+} SDMSTStubSection;
+
+#pragma mark -
+#pragma mark Declarations
+
+int SDMSTCompareStubEntries(const void *entry1, const void *entry2);
+uint32_t SDMSTStubSectionKind(struct SDMSTSectionInfo *section);
+uint32_t SDMSTStubSections(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTStubSection **sections);
+uint8_t* SDMSTStubOwnedCopy(const uint8_t *data, uint64_t size, bool *owned);
+bool SDMSTStubLinkeditFits(struct SDMMOLibrarySymbolTable *libTable, uint64_t size);
+
+#pragma mark -
+#pragma mark Functions
+
+int SDMSTCompareStubEntries(const void *entry1, const void *entry2) {
+	const struct SDMSTStubEntry *stub1 = (const struct SDMSTStubEntry *)entry1;
+	const struct SDMSTStubEntry *stub2 = (const struct SDMSTStubEntry *)entry2;
+	return (stub1->address < stub2->address ? -1 : (stub1->address > stub2->address ? 1 : 0));
+}
+
+uint32_t SDMSTStubSectionKind(struct SDMSTSectionInfo *section) {
+	uint32_t kind = UINT32_MAX;
+	switch (section->flags & SECTION_TYPE) {
+		case S_SYMBOL_STUBS: {
+			kind = kSDMSTStubCode;
+			break;
+		};
+		case S_LAZY_SYMBOL_POINTERS:
+		case S_LAZY_DYLIB_SYMBOL_POINTERS: {
+			kind = kSDMSTStubLazyPointer;
+			break;
+		};
+		case S_NON_LAZY_SYMBOL_POINTERS:
+		case S_THREAD_LOCAL_VARIABLE_POINTERS: {
+			kind = kSDMSTStubPointer;
+			break;
+		};
+		default: {
+			break;
+		};
+	}
+	return kind;
+}
+
+uint32_t SDMSTStubSections(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTStubSection **sections) {
+	// Stub sections give their slot size in reserved2; pointer sections are pointer sized. Both start their run of the
+	// indirect symbol table at reserved1.
+	uint32_t count = 0x0;
+	struct SDMSTCommandIndex *index = libTable->libInfo->commandIndex;
+	*sections = NULL;
+	for (uint32_t i = 0x0; index && i < index->sectionCount; i++) {
+		struct SDMSTSectionInfo *section = &(index->sections[i]);
+		uint32_t kind = SDMSTStubSectionKind(section);
+		uint32_t stride = (kind == kSDMSTStubCode ? section->reserved2 : (libTable->libInfo->is64bit ? sizeof(uint64_t) : sizeof(uint32_t)));
+		if (kind != UINT32_MAX && stride && section->size >= stride) {
+			*sections = realloc(*sections, sizeof(struct SDMSTStubSection) * (count + 0x1));
+			(*sections)[count++] = (struct SDMSTStubSection){(uintptr_t)(section->address + (uint64_t)libTable->libInfo->vmSlide), (uint32_t)(section->size / stride), stride, kind, section->reserved1};
+		}
+	}
+	return count;
+}
+
+uint8_t* SDMSTStubOwnedCopy(const uint8_t *data, uint64_t size, bool *owned) {
+	uint8_t *copy = (uint8_t *)data;
+	if (data && !*owned) {
+		copy = (uint8_t *)calloc((size_t)(size + 0x1), sizeof(uint8_t));
+		memcpy(copy, data, (size_t)size);
+		*owned = true;
+	}
+	return copy;
+}
+
+bool SDMSTStubLinkeditFits(struct SDMMOLibrarySymbolTable *libTable, uint64_t size) {
+	// Table sizes are worked out in 64 bits from their counts; one that cannot be described in 32 bits, or is larger than
+	// all of __LINKEDIT, comes from a malformed count and is not read at all.
+	struct SDMSTSegmentInfo *linkSegment = SDMSTSegmentNamed(libTable->libInfo->commandIndex, SEG_LINKEDIT);
+	return (size <= UINT32_MAX && (linkSegment == NULL || size <= linkSegment->filesize));
+}
+
+bool SDMSTAddressInStubSection(struct SDMMOLibrarySymbolTable *libTable, void* address) {
+	struct SDMSTCommandIndex *index = libTable->libInfo->commandIndex;
+	for (uint32_t i = 0x0; index && i < index->sectionCount; i++) {
+		struct SDMSTSectionInfo *section = &(index->sections[i]);
+		uintptr_t start = (uintptr_t)(section->address + (uint64_t)libTable->libInfo->vmSlide);
+		if ((uintptr_t)address >= start && (uintptr_t)address - start < section->size && SDMSTStubSectionKind(section) != UINT32_MAX)
+			return true;
+	}
+	return false;
+}
+
+struct SDMSTStubIndex* SDMSTStubIndexCreate(struct SDMMOLibrarySymbolTable *libTable) {
+	// Every stub and symbol pointer slot takes the name of its LC_DYSYMTAB indirect symbol, so a call or load through one
+	// resolves to the imported symbol with a single binary search. Slots for local or absolute symbols are not imports
+	// and are left out. Use SDMSTLoadStubIndex, which builds this once per table.
+	if (libTable == NULL || libTable->libInfo == NULL || libTable->libInfo->symtabCount == 0x0)
+		return NULL;
+	struct SDMSTStubIndex *index = (struct SDMSTStubIndex *)calloc(0x1, sizeof(struct SDMSTStubIndex));
+	struct symtab_command *symtab = &(libTable->libInfo->symtabCommands[0x0]);
+	uint64_t entrySize = sizeof(struct SDMSTSymbolTableListEntry) + (libTable->libInfo->is64bit ? sizeof(uint64_t) : sizeof(uint32_t));
+	bool indirectOwned = false, symbolsOwned = false, stringsOwned = false;
+	uint64_t indirectSize = (uint64_t)libTable->libInfo->indirectSymbolCount * sizeof(uint32_t), symbolsSize = (uint64_t)symtab->nsyms * entrySize;
+	const uint32_t *indirect = (SDMSTStubLinkeditFits(libTable, indirectSize) ? (const uint32_t *)SDMSTLinkeditData(libTable, libTable->libInfo->indirectSymbolOffset, (uint32_t)indirectSize, &indirectOwned) : NULL);
+	const uint8_t *symbols = (indirect && SDMSTStubLinkeditFits(libTable, symbolsSize) ? SDMSTLinkeditData(libTable, symtab->symoff, (uint32_t)symbolsSize, &symbolsOwned) : NULL);
+	const char *strings = (symbols ? (const char *)SDMSTLinkeditData(libTable, symtab->stroff, symtab->strsize, &stringsOwned) : NULL);
+	if (strings && libTable->byteSwapped) {
+		// A foreign-endian image's indirect and nlist tables are swapped in bulk into owned copies before any slot is read.
+		uint32_t *swappedIndirect = (uint32_t *)SDMSTStubOwnedCopy((const uint8_t *)indirect, indirectSize, &indirectOwned);
+		uint8_t *swappedSymbols = SDMSTStubOwnedCopy(symbols, symbolsSize, &symbolsOwned);
+		SDMSTSwapWords(swappedIndirect, libTable->libInfo->indirectSymbolCount);
+		SDMSTSwapSymbolEntries(swappedSymbols, symtab->nsyms, libTable->libInfo->is64bit);
+		indirect = swappedIndirect;
+		symbols = swappedSymbols;
+	}
+	struct SDMSTStubSection *sections = NULL;
+	uint32_t sectionCount = (strings ? SDMSTStubSections(libTable, &sections) : 0x0);
+	uint64_t slotCount = 0x0, namesSize = 0x0;
+	for (uint32_t i = 0x0; i < sectionCount; i++)
+		slotCount += sections[i].slotCount;
+	index->entries = (struct SDMSTStubEntry *)calloc(slotCount + 0x1, sizeof(struct SDMSTStubEntry));
+	for (uint32_t i = 0x0; i < sectionCount; i++) {
+		for (uint32_t slot = 0x0; slot < sections[i].slotCount && (uint64_t)sections[i].firstIndirect + slot < libTable->libInfo->indirectSymbolCount; slot++) {
+			uint32_t symbolNumber = indirect[sections[i].firstIndirect + slot];
+			if ((symbolNumber & (INDIRECT_SYMBOL_LOCAL | INDIRECT_SYMBOL_ABS)) || symbolNumber >= symtab->nsyms)
+				continue;
+			uint32_t nameOffset = ((const struct SDMSTSymbolTableListEntry *)(symbols + symbolNumber * entrySize))->n_un.n_strx;
+			if (nameOffset == 0x0 || nameOffset >= symtab->strsize)
+				continue;
+			// Names are collected as offsets into the string table and copied into one block once its size is known.
+			index->entries[index->count++] = (struct SDMSTStubEntry){sections[i].address + (uintptr_t)slot * sections[i].stride, sections[i].stride, sections[i].kind, symbolNumber, (char*)(uintptr_t)nameOffset};
+			namesSize += strnlen(strings + nameOffset, symtab->strsize - nameOffset) + 0x1;
+		}
+	}
+	index->names = (char *)calloc(namesSize + 0x1, sizeof(char));
+	char *name = index->names;
+	for (uint32_t i = 0x0; i < index->count; i++) {
+		uint32_t nameOffset = (uint32_t)(uintptr_t)index->entries[i].name;
+		uint64_t length = strnlen(strings + nameOffset, symtab->strsize - nameOffset);
+		memcpy(name, strings + nameOffset, length);
+		index->entries[i].name = name;
+		name += length + 0x1;
+	}
+	qsort(index->entries, index->count, sizeof(struct SDMSTStubEntry), SDMSTCompareStubEntries);
+	// Each slot also gets a symbol record, so address lookups can hand a slot back like any other symbol.
+	index->symbols = (struct SDMSTMachOSymbol *)calloc(index->count + 0x1, sizeof(struct SDMSTMachOSymbol));
+	for (uint32_t i = 0x0; i < index->count; i++)
+		index->symbols[i] = (struct SDMSTMachOSymbol){0x0, index->entries[i].symbolNumber, (void*)index->entries[i].address, index->entries[i].name, true, (uint32_t)strlen(index->entries[i].name)};
+	free(sections);
+	if (indirectOwned)
+		free((void *)indirect);
+	if (symbolsOwned)
+		free((void *)symbols);
+	if (stringsOwned)
+		free((void *)strings);
+	return index;
+}
+
+uint32_t SDMSTBuildStubIndex(struct SDMMOLibrarySymbolTable *libTable) {
+	struct SDMSTStubIndex *index = SDMSTLoadStubIndex(libTable);
+	return (index ? index->count : 0x0);
+}
+
+struct SDMSTStubEntry* SDMSTStubForAddress(struct SDMMOLibrarySymbolTable *libTable, void* address) {
+	struct SDMSTStubEntry *stub = NULL;
+	struct SDMSTStubIndex *index = (libTable ? __atomic_load_n(&(libTable->stubIndex), __ATOMIC_ACQUIRE) : NULL);
+	if (index) {
+		uint32_t low = 0x0, high = index->count;
+		while (low < high) {
+			uint32_t middle = low + ((high - low) >> 1);
+			if (index->entries[middle].address <= (uintptr_t)address)
+				low = middle + 0x1;
+			else
+				high = middle;
+		}
+		if (low && (uintptr_t)address - index->entries[low - 0x1].address < index->entries[low - 0x1].size)
+			stub = &(index->entries[low - 0x1]);
+	}
+	return stub;
+}
+
+void SDMSTStubIndexRelease(struct SDMSTStubIndex *index) {
+	if (index) {
+		free(index->entries);
+		free(index->symbols);
+		free(index->names);
+		free(index);
+	}
+}
+
+#endif
@@ -0,0 +1,279 @@
+/*
+ *  SDMSTSymbolicate.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTSYMBOLICATE_C_
+#define _SDMSTSYMBOLICATE_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTSymbolicate.h"
+#include "SDMMachO.h"
+#include "SDMSTCommandIndex.h"
+#include "SDMSTWorkers.h"
+#include <pthread.h>
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTAddressQuery {
+	uintptr_t address;
+	uint32_t index;
+} SDMSTAddressQuery;
+
+typedef struct SDMSTSymbolicateChunk {
+	struct SDMMOLibrarySymbolTable *libTable;
+	void **addresses;
+	struct SDMSTSymbolicatedAddress *results;
+	uint32_t begin;
+	uint32_t end;
+	uint32_t resolved;
+} SDMSTSymbolicateChunk;
+
+typedef struct SDMSTCodeRange {
+	uintptr_t start;
+	uintptr_t end;
+} SDMSTCodeRange;
+
+#pragma mark -
+#pragma mark Declarations
+
+int SDMSTCompareAddressQueries(const void *entry1, const void *entry2);
+uint32_t SDMSTSymbolicateAdvance(const uintptr_t *offsets, uint32_t count, uint32_t cursor, uintptr_t address);
+void* SDMSTSymbolicateChunkWorker(void *context);
+uint32_t SDMSTSymbolicateCodeRanges(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTCodeRange **ranges);
+uintptr_t SDMSTSymbolicateSymbolEnd(struct SDMMOLibrarySymbolTable *libTable, uint32_t symbol);
+int SDMSTCompareCodeRanges(const void *entry1, const void *entry2);
+uint32_t SDMSTSymbolicateFillSpan(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTSymbolSpan *span, uintptr_t start, uintptr_t end, uint32_t floor, uint32_t options);
+
+#pragma mark -
+#pragma mark Functions
+
+int SDMSTCompareAddressQueries(const void *entry1, const void *entry2) {
+	const struct SDMSTAddressQuery *query1 = (const struct SDMSTAddressQuery *)entry1;
+	const struct SDMSTAddressQuery *query2 = (const struct SDMSTAddressQuery *)entry2;
+	if (query1->address != query2->address)
+		return (query1->address < query2->address ? -1 : 1);
+	return (query1->index < query2->index ? -1 : (query1->index > query2->index ? 1 : 0));
+}
+
+uint32_t SDMSTSymbolicateAdvance(const uintptr_t *offsets, uint32_t count, uint32_t cursor, uintptr_t address) {
+	// Returns the first entry at or after cursor that starts past address; gallops so sparse queries do not walk the whole table.
+	if (cursor >= count || offsets[cursor] > address)
+		return cursor;
+	uint32_t low = cursor, step = 0x1;
+	while (low + step < count && offsets[low + step] <= address) {
+		low += step;
+		step <<= 1;
+	}
+	uint32_t high = (low + step < count ? low + step : count);
+	while (high - low > 0x1) {
+		uint32_t middle = low + ((high - low) >> 1);
+		if (offsets[middle] <= address)
+			low = middle;
+		else
+			high = middle;
+	}
+	return high;
+}
+
+void* SDMSTSymbolicateChunkWorker(void *context) {
+	struct SDMSTSymbolicateChunk *chunk = (struct SDMSTSymbolicateChunk *)context;
+	struct SDMSTAddressIndex *index = chunk->libTable->addressIndex;
+	uint32_t count = chunk->end - chunk->begin;
+	struct SDMSTAddressQuery *queries = (struct SDMSTAddressQuery *)calloc(count + 0x1, sizeof(struct SDMSTAddressQuery));
+	for (uint32_t i = 0x0; i < count; i++)
+		queries[i] = (struct SDMSTAddressQuery){(uintptr_t)chunk->addresses[chunk->begin + i], chunk->begin + i};
+	qsort(queries, count, sizeof(struct SDMSTAddressQuery), SDMSTCompareAddressQueries);
+	uint32_t cursor = (count ? SDMSTAddressIndexUpperBound(index, queries[0x0].address) : 0x0);
+	for (uint32_t i = 0x0; i < count; i++) {
+		cursor = SDMSTSymbolicateAdvance(index->offsets, index->count, cursor, queries[i].address);
+		struct SDMSTSymbolicatedAddress *result = &(chunk->results[queries[i].index]);
+		if (cursor && SDMSTAddressIndexCovers(index, cursor - 0x1, queries[i].address)) {
+			result->symbol = &(chunk->libTable->table[cursor - 0x1]);
+			result->offset = (uint64_t)(queries[i].address - index->offsets[cursor - 0x1]);
+			chunk->resolved++;
+		} else {
+			result->symbol = NULL;
+			result->offset = 0x0;
+		}
+	}
+	free(queries);
+	return NULL;
+}
+
+uint32_t SDMSTSymbolizeAddresses(struct SDMMOLibrarySymbolTable *libTable, void **addresses, uint32_t count, struct SDMSTSymbolicatedAddress *results) {
+	uint32_t resolved = 0x0;
+	if (SDMSTMaterializeSymbols(libTable) && libTable->addressIndex && addresses && results && count) {
+		uint32_t chunkCount = 0x1;
+		if (count >= kSDMSTSymbolicateParallelMinimum) {
+			chunkCount = count / kSDMSTSymbolicateChunkMinimum;
+			if (chunkCount > SDMSTOnlineProcessors())
+				chunkCount = SDMSTOnlineProcessors();
+		}
+		// Chunks are contiguous slices of the input, each sorted and merged on its own, so no thread waits on a global sort.
+		struct SDMSTSymbolicateChunk *chunks = (struct SDMSTSymbolicateChunk *)calloc(chunkCount, sizeof(struct SDMSTSymbolicateChunk));
+		pthread_t *threads = (pthread_t *)calloc(chunkCount, sizeof(pthread_t));
+		bool *started = (bool *)calloc(chunkCount, sizeof(bool));
+		for (uint32_t i = 0x0; i < chunkCount; i++) {
+			chunks[i] = (struct SDMSTSymbolicateChunk){libTable, addresses, results, (uint32_t)(((uint64_t)count * i) / chunkCount), (uint32_t)(((uint64_t)count * (i + 0x1)) / chunkCount), 0x0};
+			if (i)
+				started[i] = (pthread_create(&threads[i], NULL, SDMSTSymbolicateChunkWorker, &chunks[i]) == 0x0);
+		}
+		SDMSTSymbolicateChunkWorker(&chunks[0x0]);
+		for (uint32_t i = 0x1; i < chunkCount; i++) {
+			if (started[i])
+				pthread_join(threads[i], NULL);
+			else
+				SDMSTSymbolicateChunkWorker(&chunks[i]);
+		}
+		for (uint32_t i = 0x0; i < chunkCount; i++)
+			resolved += chunks[i].resolved;
+		free(started);
+		free(threads);
+		free(chunks);
+	}
+	return resolved;
+}
+
+uint32_t SDMSTSymbolicateCodeRanges(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTCodeRange **ranges) {
+	uint32_t count = 0x0;
+	*ranges = NULL;
+	struct SDMSTCommandIndex *index = libTable->libInfo->commandIndex;
+	for (uint32_t i = 0x0; index && i < index->sectionCount; i++) {
+		struct SDMSTSectionInfo *section = &(index->sections[i]);
+		if (section->flags & (S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)) {
+			*ranges = realloc(*ranges, sizeof(struct SDMSTCodeRange)*(count+0x1));
+			(*ranges)[count] = (struct SDMSTCodeRange){(uintptr_t)section->address + libTable->libInfo->vmSlide, (uintptr_t)(section->address + section->size) + libTable->libInfo->vmSlide};
+			count++;
+		}
+	}
+	return count;
+}
+
+uintptr_t SDMSTSymbolicateSymbolEnd(struct SDMMOLibrarySymbolTable *libTable, uint32_t symbol) {
+	// Aliases share an extent: a symbol runs to the next distinct address or the end of the section it starts in, whichever
+	// comes first, matching what SDMSTSymbolForAddress resolves. Without section ranges the last one runs to the end of __TEXT.
+	struct SDMSTAddressIndex *index = libTable->addressIndex;
+	uint32_t next = SDMSTSymbolicateAdvance(index->offsets, index->count, symbol, index->offsets[symbol]);
+	uintptr_t end = index->offsets[symbol];
+	uintptr_t limit = SDMSTAddressIndexRangeEnd(index, end);
+	if (next < index->count) {
+		end = index->offsets[next];
+	} else if (limit != UINTPTR_MAX) {
+		end = limit;
+	} else if (libTable->libInfo->textSeg) {
+		struct SDMSTSeg64Data textData = SDMSTSegmentData(libTable->libInfo->textSeg, libTable->libInfo->is64bit);
+		uintptr_t textEnd = (uintptr_t)(textData.vmaddr + textData.vmsize) + libTable->libInfo->vmSlide;
+		if (textEnd > end)
+			end = textEnd;
+	}
+	return (end < limit ? end : limit);
+}
+
+int SDMSTCompareCodeRanges(const void *entry1, const void *entry2) {
+	const struct SDMSTCodeRange *range1 = (const struct SDMSTCodeRange *)entry1;
+	const struct SDMSTCodeRange *range2 = (const struct SDMSTCodeRange *)entry2;
+	return (range1->start < range2->start ? -1 : (range1->start > range2->start ? 1 : 0));
+}
+
+uint32_t SDMSTSymbolicateFillSpan(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTSymbolSpan *span, uintptr_t start, uintptr_t end, uint32_t floor, uint32_t options) {
+	// Points the span at the symbols overlapping [start, end), none before floor, and returns the index past the last.
+	struct SDMSTAddressIndex *index = libTable->addressIndex;
+	uint32_t first = SDMSTAddressIndexLowerBound(index, start);
+	if ((first == index->count || index->offsets[first] != start) && first) {
+		// The symbol containing start begins before it; step back to the first of its aliases if it reaches into the range.
+		uint32_t containing = SDMSTAddressIndexLowerBound(index, index->offsets[first - 0x1]);
+		if (SDMSTSymbolicateSymbolEnd(libTable, containing) > start)
+			first = containing;
+	}
+	if (first < floor)
+		first = floor;
+	uint32_t last = SDMSTAddressIndexLowerBound(index, end);
+	if (last > first) {
+		span->symbols = &(libTable->table[first]);
+		span->first = first;
+		span->count = last - first;
+		if (options & kSDMSTSymbolRangeClippedSizes) {
+			span->clippedSizes = (uint64_t *)calloc(span->count, sizeof(uint64_t));
+			uintptr_t symbolEnd = 0x0;
+			for (uint32_t i = first; i < last; i++) {
+				if (i == first || index->offsets[i] != index->offsets[i - 0x1])
+					symbolEnd = SDMSTSymbolicateSymbolEnd(libTable, i);
+				uintptr_t clipStart = (index->offsets[i] > start ? index->offsets[i] : start);
+				uintptr_t clipEnd = (symbolEnd < end ? symbolEnd : end);
+				span->clippedSizes[i - first] = (clipEnd > clipStart ? (uint64_t)(clipEnd - clipStart) : 0x0);
+			}
+		}
+	}
+	return (last > floor ? last : floor);
+}
+
+struct SDMSTSymbolSpan* SDMSTSymbolsInRange(struct SDMMOLibrarySymbolTable *libTable, void* low, void* high, uint32_t options) {
+	struct SDMSTSymbolSpan *span = (struct SDMSTSymbolSpan *)calloc(0x1, sizeof(struct SDMSTSymbolSpan));
+	if (SDMSTMaterializeSymbols(libTable) && libTable->addressIndex && low < high) {
+		uintptr_t start = (uintptr_t)low, end = (uintptr_t)high;
+		if (options & kSDMSTSymbolRangeCodeOnly) {
+			// One span per run of instruction sections inside the query, in address order; adjacent sections share a run,
+			// and a symbol already reported by an earlier run is not repeated.
+			struct SDMSTCodeRange *ranges = NULL;
+			uint32_t rangeCount = SDMSTSymbolicateCodeRanges(libTable, &ranges);
+			qsort(ranges, rangeCount, sizeof(struct SDMSTCodeRange), SDMSTCompareCodeRanges);
+			struct SDMSTSymbolSpan *tail = NULL;
+			uint32_t floor = 0x0;
+			for (uint32_t i = 0x0; i < rangeCount; i++) {
+				uintptr_t runStart = ranges[i].start, runEnd = ranges[i].end;
+				while (i + 0x1 < rangeCount && ranges[i + 0x1].start <= runEnd) {
+					i++;
+					if (ranges[i].end > runEnd)
+						runEnd = ranges[i].end;
+				}
+				if (runStart < start)
+					runStart = start;
+				if (runEnd > end)
+					runEnd = end;
+				if (runStart < runEnd) {
+					// Runs without symbols are dropped so every span in the chain after the head has entries.
+					struct SDMSTSymbolSpan filled = {0x0};
+					floor = SDMSTSymbolicateFillSpan(libTable, &filled, runStart, runEnd, floor, options);
+					if (filled.count) {
+						struct SDMSTSymbolSpan *run = (tail ? (struct SDMSTSymbolSpan *)calloc(0x1, sizeof(struct SDMSTSymbolSpan)) : span);
+						*run = filled;
+						if (tail)
+							tail->next = run;
+						tail = run;
+					}
+				}
+			}
+			free(ranges);
+		} else {
+			SDMSTSymbolicateFillSpan(libTable, span, start, end, 0x0, options);
+		}
+	}
+	return span;
+}
+
+void SDMSTSymbolSpanRelease(struct SDMSTSymbolSpan *span) {
+	while (span) {
+		struct SDMSTSymbolSpan *next = span->next;
+		free(span->clippedSizes);
+		free(span);
+		span = next;
+	}
+}
+
+#endif
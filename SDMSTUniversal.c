@@ -0,0 +1,191 @@
+/*
+ *  SDMSTUniversal.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTUNIVERSAL_C_
+#define _SDMSTUNIVERSAL_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTUniversal.h"
+#include "SDMMachO.h"
+#include "SDMSTWorkers.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTUniversalName {
+	char *name;
+	uint32_t length;
+} SDMSTUniversalName;
+
+typedef struct SDMSTUniversalBatch {
+	struct SDMSTUniversalTables *tables;
+	uint32_t next;
+} SDMSTUniversalBatch;
+
+#pragma mark -
+#pragma mark Declarations
+
+void* SDMSTUniversalIndexWorker(void *context);
+void SDMSTUniversalShareNames(struct SDMSTUniversalTables *tables);
+
+#pragma mark -
+#pragma mark Functions
+
+void* SDMSTUniversalIndexWorker(void *context) {
+	struct SDMSTUniversalBatch *batch = (struct SDMSTUniversalBatch *)context;
+	struct SDMSTUniversalTables *tables = batch->tables;
+	for (uint32_t i = __atomic_fetch_add(&batch->next, 0x1, __ATOMIC_RELAXED); i < tables->sliceCount; i = __atomic_fetch_add(&batch->next, 0x1, __ATOMIC_RELAXED)) {
+		// Slice offsets in a universal file are relative to the file, but everything inside a slice is relative to its header.
+		char *header = (char*)tables->base + tables->slices[i].offset;
+		struct SDMMOLibrarySymbolTable *table = SDMSTLoadMappedImage(tables->path, header, header, tables->base, tables->size, tables->mapping, NULL, NULL);
+		if (table->loadStatus != kSDMSTLoadOK) {
+			SDMSTLibraryRelease(table);
+			continue;
+		}
+		tables->slices[i].table = table;
+		__atomic_fetch_add(&tables->indexed, 0x1, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+void SDMSTUniversalShareNames(struct SDMSTUniversalTables *tables) {
+	// Slices of one binary mostly carry the same names, each in its own string table. Every name is pointed at its first
+	// occurrence, so lookups across all slices keep only the first slice's string pages hot. Generated names are owned
+	// by their table and keep their own copy.
+	uint64_t named = 0x0;
+	for (uint32_t i = 0x0; i < tables->sliceCount; i++)
+		if (tables->slices[i].table)
+			named += tables->slices[i].table->symbolCount;
+	if (tables->indexed < 0x2 || named == 0x0)
+		return;
+	uint64_t slotCount = 0x2;
+	while (slotCount < named * 0x2)
+		slotCount <<= 0x1;
+	struct SDMSTUniversalName *slots = (struct SDMSTUniversalName *)calloc((size_t)slotCount, sizeof(struct SDMSTUniversalName));
+	for (uint32_t i = 0x0; i < tables->sliceCount; i++) {
+		struct SDMMOLibrarySymbolTable *table = tables->slices[i].table;
+		for (uint32_t j = 0x0; table && j < table->symbolCount; j++) {
+			struct SDMSTMachOSymbol *symbol = &(table->table[j]);
+			if (symbol->isStub)
+				continue;
+			uint64_t slot = SDMSTHashName(symbol->name, symbol->nameLength, 0x0) & (slotCount - 0x1);
+			while (slots[slot].name && (slots[slot].length != symbol->nameLength || memcmp(slots[slot].name, symbol->name, symbol->nameLength)))
+				slot = (slot + 0x1) & (slotCount - 0x1);
+			if (slots[slot].name == NULL) {
+				slots[slot] = (struct SDMSTUniversalName){symbol->name, symbol->nameLength};
+			} else if (slots[slot].name != symbol->name) {
+				symbol->name = slots[slot].name;
+				tables->sharedNames++;
+			}
+		}
+	}
+	free(slots);
+}
+
+struct SDMSTUniversalTables* SDMSTUniversalLoad(char *path, uint32_t threadCount) {
+	// The file is reserved once and shared by every slice's table; pages are mapped in as each slice's build touches them.
+	int fd = (path ? open(path, O_RDONLY) : -0x1);
+	struct stat fs;
+	if (fd < 0x0)
+		return NULL;
+	struct SDMSTUniversalTables *tables = (struct SDMSTUniversalTables *)calloc(0x1, sizeof(struct SDMSTUniversalTables));
+	struct SDMSTFatSlice *slices = NULL;
+	bool valid = (fstat(fd, &fs) == 0x0);
+	tables->size = (valid ? (uint64_t)fs.st_size : 0x0);
+	tables->sliceCount = (valid ? SDMSTReadSlices(fd, tables->size, &slices) : 0x0);
+	valid = (tables->sliceCount != 0x0);
+	if (valid) {
+		tables->slices = (struct SDMSTUniversalSlice *)calloc(tables->sliceCount, sizeof(struct SDMSTUniversalSlice));
+		for (uint32_t i = 0x0; i < tables->sliceCount; i++)
+			tables->slices[i] = (struct SDMSTUniversalSlice){{slices[i].cputype, slices[i].cpusubtype}, slices[i].offset, slices[i].size, NULL};
+		void* reservation = (tables->size <= SIZE_MAX ? mmap(NULL, (size_t)tables->size, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0x0) : MAP_FAILED);
+		valid = (reservation != MAP_FAILED);
+		if (valid) {
+			tables->base = reservation;
+			tables->path = strdup(path);
+			tables->mapping = (struct SDMSTLibraryMapping *)calloc(0x1, sizeof(struct SDMSTLibraryMapping));
+			tables->mapping->fd = fd;
+			tables->mapping->pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+			tables->mapping->pages = (uint8_t *)calloc((size_t)((tables->size / tables->mapping->pageSize + 0x8) >> 0x3), sizeof(uint8_t));
+		}
+	}
+	free(slices);
+	if (!valid) {
+		close(fd);
+		SDMSTUniversalRelease(tables);
+		return NULL;
+	}
+	// Every slice's header and load commands are mapped before the workers start. A foreign-endian slice is swapped in
+	// place, and a page it shares with a neighbouring slice must not be mapped again over the swapped copy.
+	struct SDMMOLibrarySymbolTable prefault;
+	memset(&prefault, 0x0, sizeof(struct SDMMOLibrarySymbolTable));
+	prefault.mappingBase = tables->base;
+	prefault.librarySize = tables->size;
+	prefault.mapping = tables->mapping;
+	for (uint32_t i = 0x0; i < tables->sliceCount; i++) {
+		char *header = (char*)tables->base + tables->slices[i].offset;
+		if (SDMSTMapLibraryRange(&prefault, header, sizeof(struct mach_header_64), false))
+			SDMSTMapLibraryRange(&prefault, header, SDMSTImageCommandsSize((struct mach_header *)header), false);
+	}
+	struct SDMSTUniversalBatch batch = {tables, 0x0};
+	SDMSTRunWorkers(threadCount, tables->sliceCount, SDMSTUniversalIndexWorker, &batch);
+	SDMSTUniversalShareNames(tables);
+	return tables;
+}
+
+struct SDMMOLibrarySymbolTable* SDMSTUniversalTableForArch(struct SDMSTUniversalTables *tables, cpu_type_t cputype, cpu_subtype_t cpusubtype) {
+	// Same rules as picking a slice to load: the cputype must match and the subtype breaks ties.
+	struct SDMMOLibrarySymbolTable *table = NULL;
+	if (tables && tables->sliceCount) {
+		struct SDMSTFatSlice *slices = (struct SDMSTFatSlice *)calloc(tables->sliceCount, sizeof(struct SDMSTFatSlice));
+		for (uint32_t i = 0x0; i < tables->sliceCount; i++)
+			slices[i] = (struct SDMSTFatSlice){tables->slices[i].arch.type, tables->slices[i].arch.subtype, tables->slices[i].offset, tables->slices[i].size, 0x0};
+		int32_t selected = SDMSTSelectSlice(slices, tables->sliceCount, cputype, cpusubtype);
+		if (selected >= 0x0)
+			table = tables->slices[selected].table;
+		free(slices);
+	}
+	return table;
+}
+
+void SDMSTUniversalRelease(struct SDMSTUniversalTables *tables) {
+	if (tables) {
+		for (uint32_t i = 0x0; i < tables->sliceCount && tables->slices; i++) {
+			if (tables->slices[i].table)
+				SDMSTLibraryRelease(tables->slices[i].table);
+		}
+		free(tables->slices);
+		if (tables->base)
+			munmap(tables->base, (size_t)tables->size);
+		if (tables->mapping) {
+			close(tables->mapping->fd);
+			free(tables->mapping->pages);
+			free(tables->mapping);
+		}
+		free(tables->path);
+		free(tables);
+	}
+}
+
+#endif
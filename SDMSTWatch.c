@@ -0,0 +1,227 @@
+/*
+ *  SDMSTWatch.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTWATCH_C_
+#define _SDMSTWATCH_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTWatch.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#pragma mark -
+#pragma mark Declarations
+
+bool SDMSTWatchFileChanged(struct stat *previous, struct stat *current);
+void SDMSTWatchSynchronize(struct SDMSTWatchedLibrary *library);
+void SDMSTWatchedLibraryCheck(struct SDMSTWatchedLibrary *library);
+void SDMSTWatchedLibraryFree(struct SDMSTWatchedLibrary *library);
+void* SDMSTWatcherThread(void *context);
+
+#pragma mark -
+#pragma mark Functions
+
+bool SDMSTWatchFileChanged(struct stat *previous, struct stat *current) {
+	if (previous->st_dev != current->st_dev || previous->st_ino != current->st_ino || previous->st_size != current->st_size || previous->st_mtime != current->st_mtime)
+		return true;
+#ifdef __APPLE__
+	return (previous->st_mtimespec.tv_nsec != current->st_mtimespec.tv_nsec);
+#else
+	return (previous->st_mtim.tv_nsec != current->st_mtim.tv_nsec);
+#endif
+}
+
+void SDMSTWatchSynchronize(struct SDMSTWatchedLibrary *library) {
+	// Waits out every reader that could still hold the table that was just swapped out. Readers count themselves in the
+	// slot of the epoch they saw before loading the table pointer, so once both slots have drained after a flip each, no
+	// reader that loaded the old pointer is left. Only the reloading thread ever waits here; readers never do.
+	for (uint32_t pass = 0x0; pass < 0x2; pass++) {
+		uint32_t epoch = __atomic_fetch_xor(&library->epoch, 0x1, __ATOMIC_SEQ_CST);
+		while (__atomic_load_n(&library->readers[epoch & 0x1], __ATOMIC_SEQ_CST))
+			sched_yield();
+	}
+}
+
+struct SDMMOLibrarySymbolTable* SDMSTWatchedLibraryAcquire(struct SDMSTWatchedLibrary *library, uint32_t *token) {
+	// The table stays valid until the matching relinquish, even if a reload swaps in a newer one meanwhile.
+	uint32_t slot = __atomic_load_n(&library->epoch, __ATOMIC_SEQ_CST) & 0x1;
+	__atomic_fetch_add(&library->readers[slot], 0x1, __ATOMIC_SEQ_CST);
+	*token = slot;
+	return __atomic_load_n(&library->table, __ATOMIC_SEQ_CST);
+}
+
+void SDMSTWatchedLibraryRelinquish(struct SDMSTWatchedLibrary *library, uint32_t token) {
+	__atomic_fetch_sub(&library->readers[token & 0x1], 0x1, __ATOMIC_SEQ_CST);
+}
+
+bool SDMSTWatchedLibraryReload(struct SDMSTWatchedLibrary *library) {
+	// The replacement is fully built before it is published with a single pointer store; a file caught mid-write fails to
+	// load and the current table stays in place until the next change.
+	struct stat fileStatus;
+	if (stat(library->path, &fileStatus) != 0x0)
+		return false;
+	struct SDMMOLibrarySymbolTable *table = SDMSTLoadLibraryWithOptions(library->path, &(library->options));
+	if (table->loadStatus != kSDMSTLoadOK) {
+		SDMSTLibraryRelease(table);
+		return false;
+	}
+	struct SDMMOLibrarySymbolTable *previous = __atomic_exchange_n(&library->table, table, __ATOMIC_SEQ_CST);
+	library->fileStatus = fileStatus;
+	__atomic_fetch_add(&library->generation, 0x1, __ATOMIC_RELEASE);
+	if (previous) {
+		SDMSTWatchSynchronize(library);
+		SDMSTLibraryRelease(previous);
+	}
+	return true;
+}
+
+void SDMSTWatchedLibraryCheck(struct SDMSTWatchedLibrary *library) {
+	struct stat fileStatus;
+	if (stat(library->path, &fileStatus) == 0x0 && (library->pending || SDMSTWatchFileChanged(&(library->fileStatus), &fileStatus)))
+		library->pending = !SDMSTWatchedLibraryReload(library);
+}
+
+void* SDMSTWatcherThread(void *context) {
+	struct SDMSTWatcher *watcher = (struct SDMSTWatcher *)context;
+	struct pollfd fds[0x2] = {{watcher->wakeFds[0x0], POLLIN, 0x0}, {watcher->notifyFd, POLLIN, 0x0}};
+	nfds_t fdCount = (watcher->notifyFd >= 0x0 ? 0x2 : 0x1);
+	char *events = (char *)calloc(kSDMSTWatchEventBufferSize, sizeof(char));
+	while (__atomic_load_n(&watcher->running, __ATOMIC_ACQUIRE)) {
+		int ready = poll(fds, fdCount, kSDMSTWatchPollInterval);
+		if (!__atomic_load_n(&watcher->running, __ATOMIC_ACQUIRE))
+			break;
+		pthread_mutex_lock(&watcher->lock);
+#ifdef __linux__
+		if (ready > 0x0 && fdCount > 0x1 && (fds[0x1].revents & POLLIN)) {
+			// Build tools usually write a new file and rename it over the old one, so the directory is watched rather than
+			// the file; only events naming a watched library send it to the stat check.
+			ssize_t length;
+			while ((length = read(watcher->notifyFd, events, kSDMSTWatchEventBufferSize)) > 0x0) {
+				for (char *cursor = events; cursor < events + length;) {
+					struct inotify_event *event = (struct inotify_event *)cursor;
+					for (uint32_t i = 0x0; i < watcher->libraryCount; i++) {
+						struct SDMSTWatchedLibrary *library = watcher->libraries[i];
+						if (library->watchDescriptor == event->wd && (event->len == 0x0 || !strcmp(event->name, library->name)))
+							library->pending = true;
+					}
+					cursor += sizeof(struct inotify_event) + event->len;
+				}
+			}
+		}
+#endif
+		// Without inotify every library is checked each interval; with it, only the ones an event or a failed reload left pending.
+		for (uint32_t i = 0x0; i < watcher->libraryCount; i++) {
+			struct SDMSTWatchedLibrary *library = watcher->libraries[i];
+			if (watcher->notifyFd < 0x0 || library->pending)
+				SDMSTWatchedLibraryCheck(library);
+		}
+		pthread_mutex_unlock(&watcher->lock);
+	}
+	free(events);
+	return NULL;
+}
+
+struct SDMSTWatcher* SDMSTWatcherCreate(void) {
+	struct SDMSTWatcher *watcher = (struct SDMSTWatcher *)calloc(0x1, sizeof(struct SDMSTWatcher));
+	watcher->notifyFd = -0x1;
+#ifdef __linux__
+	watcher->notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	if (pipe(watcher->wakeFds) != 0x0) {
+		if (watcher->notifyFd >= 0x0)
+			close(watcher->notifyFd);
+		free(watcher);
+		return NULL;
+	}
+	pthread_mutex_init(&watcher->lock, NULL);
+	watcher->running = true;
+	if (pthread_create(&watcher->thread, NULL, SDMSTWatcherThread, watcher) != 0x0) {
+		watcher->running = false;
+		SDMSTWatcherRelease(watcher);
+		return NULL;
+	}
+	return watcher;
+}
+
+struct SDMSTWatchedLibrary* SDMSTWatcherAdd(struct SDMSTWatcher *watcher, char *path, struct SDMSTLoadOptions *options) {
+	if (watcher == NULL || path == NULL)
+		return NULL;
+	struct SDMSTWatchedLibrary *library = (struct SDMSTWatchedLibrary *)calloc(0x1, sizeof(struct SDMSTWatchedLibrary));
+	library->path = strdup(path);
+	if (options)
+		library->options = *options;
+	// A table built from a mapping faults once its file is truncated and rewritten in place, and dyld would hand back the
+	// image it already has for the path, so watched libraries are always streamed into memory the table owns.
+	if (library->options.streamWindow == 0x0)
+		library->options.streamWindow = kSDMSTWatchStreamWindow;
+	char *slash = strrchr(library->path, '/');
+	library->directory = (slash ? strndup(library->path, (size_t)(slash == library->path ? 0x1 : slash - library->path)) : strdup("."));
+	library->name = (slash ? slash + 0x1 : library->path);
+	library->watchDescriptor = -0x1;
+	if (!SDMSTWatchedLibraryReload(library)) {
+		SDMSTWatchedLibraryFree(library);
+		return NULL;
+	}
+	pthread_mutex_lock(&watcher->lock);
+#ifdef __linux__
+	if (watcher->notifyFd >= 0x0)
+		library->watchDescriptor = inotify_add_watch(watcher->notifyFd, library->directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+#endif
+	watcher->libraries = realloc(watcher->libraries, sizeof(struct SDMSTWatchedLibrary *) * (watcher->libraryCount + 0x1));
+	watcher->libraries[watcher->libraryCount++] = library;
+	pthread_mutex_unlock(&watcher->lock);
+	return library;
+}
+
+void SDMSTWatchedLibraryFree(struct SDMSTWatchedLibrary *library) {
+	if (library->table)
+		SDMSTLibraryRelease(library->table);
+	free(library->directory);
+	free(library->path);
+	free(library);
+}
+
+void SDMSTWatcherRelease(struct SDMSTWatcher *watcher) {
+	// Readers must be done with every watched library before the watcher is released.
+	if (watcher) {
+		if (watcher->running) {
+			__atomic_store_n(&watcher->running, false, __ATOMIC_RELEASE);
+			ssize_t woken = write(watcher->wakeFds[0x1], "", 0x1);
+			(void)woken;
+			pthread_join(watcher->thread, NULL);
+		}
+		for (uint32_t i = 0x0; i < watcher->libraryCount; i++)
+			SDMSTWatchedLibraryFree(watcher->libraries[i]);
+		free(watcher->libraries);
+		if (watcher->notifyFd >= 0x0)
+			close(watcher->notifyFd);
+		close(watcher->wakeFds[0x0]);
+		close(watcher->wakeFds[0x1]);
+		pthread_mutex_destroy(&watcher->lock);
+		free(watcher);
+	}
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ *  SDMSTWatch.h
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTWATCH_H_
+#define _SDMSTWATCH_H_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSymbolTable.h"
+#include <pthread.h>
+#include <sys/stat.h>
+
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTWatchPollInterval 0x3e8
+#define kSDMSTWatchEventBufferSize 0x1000
+#define kSDMSTWatchStreamWindow 0x100000
+
+#pragma mark -
+#pragma mark Types
+
+typedef struct SDMSTWatchedLibrary {
+	char *path;
+	char *directory;
+	char *name;
+	struct SDMSTLoadOptions options;
+	struct SDMMOLibrarySymbolTable *table;
+	uint32_t epoch;
+	uint32_t readers[0x2];
+	uint64_t generation;
+	struct stat fileStatus;
+	int watchDescriptor;
+	bool pending;
+} SDMSTWatchedLibrary;
+
+typedef struct SDMSTWatcher {
+	int notifyFd;
+	int wakeFds[0x2];
+	pthread_t thread;
+	volatile bool running;
+	pthread_mutex_t lock;
+	struct SDMSTWatchedLibrary **libraries;
+	uint32_t libraryCount;
+} SDMSTWatcher;
+
+#pragma mark -
+#pragma mark Declarations
+
+struct SDMSTWatcher* SDMSTWatcherCreate(void);
+struct SDMSTWatchedLibrary* SDMSTWatcherAdd(struct SDMSTWatcher *watcher, char *path, struct SDMSTLoadOptions *options);
+struct SDMMOLibrarySymbolTable* SDMSTWatchedLibraryAcquire(struct SDMSTWatchedLibrary *library, uint32_t *token);
+void SDMSTWatchedLibraryRelinquish(struct SDMSTWatchedLibrary *library, uint32_t token);
+bool SDMSTWatchedLibraryReload(struct SDMSTWatchedLibrary *library);
+void SDMSTWatcherRelease(struct SDMSTWatcher *watcher);
+
+#endif
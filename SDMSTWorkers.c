@@ -0,0 +1,56 @@
+/*
+ *  SDMSTWorkers.c
+ *  SDMSymbolTable
+ *
+ *  Copyright (c) 2013, Sam Marshall
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. All advertising materials mentioning features or use of this software must display the following acknowledgement:
+ *  	This product includes software developed by the Sam Marshall.
+ *  4. Neither the name of the Sam Marshall nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ * 
+ *  THIS SOFTWARE IS PROVIDED BY Sam Marshall ''AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Sam Marshall BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef _SDMSTWORKERS_C_
+#define _SDMSTWORKERS_C_
+
+#pragma mark -
+#pragma mark Includes
+#include "SDMSTWorkers.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#pragma mark -
+#pragma mark Functions
+
+uint32_t SDMSTOnlineProcessors(void) {
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	return (online > 0x0 ? (uint32_t)online : 0x1);
+}
+
+void SDMSTRunWorkers(uint32_t threadCount, uint32_t workCount, void* (*worker)(void *), void *context) {
+	// Every worker pulls items from the shared context until it runs dry, so the calling thread is one of them and a
+	// thread that fails to start only costs parallelism. A zero thread count means one per online processor.
+	if (threadCount == 0x0)
+		threadCount = SDMSTOnlineProcessors();
+	if (threadCount > workCount)
+		threadCount = workCount;
+	pthread_t *threads = (pthread_t *)calloc(threadCount + 0x1, sizeof(pthread_t));
+	uint32_t started = 0x0;
+	for (uint32_t i = 0x1; i < threadCount; i++) {
+		if (pthread_create(&threads[started], NULL, worker, context) == 0x0)
+			started++;
+	}
+	worker(context);
+	for (uint32_t i = 0x0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+#endif
@@ -26,27 +26,83 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <pthread.h>
+#ifdef __APPLE__
 #include <dlfcn.h>
-#include <mach/mach.h>
 #include <mach-o/dyld.h>
-#include <mach-o/nlist.h>
-#include <mach-o/ldsyms.h>
-#include <math.h>
+#endif
 #include "disasm.h"
 #include "SDMMachO.h"
+#include "SDMSTString.h"
+#include "SDMSTImageMap.h"
+#include "SDMSTExportTrie.h"
+#include "SDMSTStubIndex.h"
+#include "SDMSTCommandIndex.h"
+#include "SDMSTIndexCache.h"
+
+#pragma mark -
+#pragma mark Internal Types
+
+typedef struct SDMSTStreamWindow {
+	int fd;
+	uint64_t base;
+	uint64_t limit;
+	char *buffer;
+	uint64_t size;
+	uint64_t start;
+	uint64_t length;
+} SDMSTStreamWindow;
+
+typedef struct SDMSTSymbolSource {
+	bool ready;
+	struct SDMSTMachOSymbol *symbols;
+	uint32_t count;
+	char *names;
+} SDMSTSymbolSource;
+
+typedef struct SDMSTSymbolSources {
+	pthread_mutex_t lock;
+	bool ready;
+	bool lazy;
+	uint32_t count;
+	struct SDMSTSymbolSource *sources;
+} SDMSTSymbolSources;
 
 #pragma mark -
 #pragma mark Declarations
 
 void SDMSTBuildLibraryInfo(SDMMOLibrarySymbolTable *libTable);
 int SDMSTCompareTableEntries(const void *entry1, const void *entry2);
+void SDMSTAppendSymbol(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTSymbolSource *source, uint32_t tableNumber, uint32_t symbolNumber, uint64_t value, bool named, char *name, uint32_t nameLength);
+char* SDMSTStreamWindowAt(struct SDMSTStreamWindow *window, uint64_t offset, uint64_t needed, uint64_t *available);
+void SDMSTStreamSymbolTable(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTSymbolSource *source, uint32_t tableNumber, struct symtab_command *cmd, uint64_t entrySize);
+void SDMSTBuildFunctionStarts(struct SDMMOLibrarySymbolTable *libTable);
+void SDMSTAddUnnamedFunctions(struct SDMMOLibrarySymbolTable *libTable);
+char* SDMSTSymbolTableBase(struct SDMMOLibrarySymbolTable *libTable, uint32_t tableNumber);
+void SDMSTReadSymbolSource(struct SDMMOLibrarySymbolTable *libTable, uint32_t tableNumber);
+void SDMSTCreateSymbolSources(struct SDMMOLibrarySymbolTable *libTable, bool lazy);
+struct SDMSTSymbolSource* SDMSTSymbolSourceAt(struct SDMMOLibrarySymbolTable *libTable, uint32_t tableNumber);
+void SDMSTMergeSymbolSources(struct SDMMOLibrarySymbolTable *libTable);
+bool SDMSTSyntheticNameSuffix(char *symbolName, uint64_t length);
+void* SDMSTSymbolSourcesLookup(struct SDMMOLibrarySymbolTable *libTable, char *symbolName, uint64_t length);
 void SDMSTGenerateSortedSymbolTable(struct SDMMOLibrarySymbolTable *libTable);
+void SDMSTBuildAddressIndex(struct SDMMOLibrarySymbolTable *libTable);
+uint32_t SDMSTSymbolRanges(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTAddressRange **ranges);
+bool SDMSTSwapLibraryCommands(struct SDMMOLibrarySymbolTable *libTable, void* header, uint64_t commandsSize);
+void* SDMSTMapLibrarySlice(struct SDMMOLibrarySymbolTable *table, char *path, struct SDMSTLoadOptions *options);
+void* SDMSTReadLibraryCommands(struct SDMMOLibrarySymbolTable *table, int fd, struct SDMSTFatSlice *slice, uint32_t streamWindow);
 bool SMDSTSymbolDemangleAndCompare(char *symFromTable, char *symbolName);
 uint32_t SDMSTGetFunctionLength(struct SDMMOLibrarySymbolTable *libTable, void* functionPointer);
 uint32_t SDMSTGetArgumentCount(struct SDMMOLibrarySymbolTable *libTable, void* functionPointer);
-SDMSTFunctionCall SDMSTSymbolLookup(struct SDMMOLibrarySymbolTable *libTable, char *symbolName);
+void* SDMSTNameIndexLookup(struct SDMMOLibrarySymbolTable *libTable, char *symbolName);
 
+#ifdef __APPLE__
 extern void* makeDynamicCallWithIntList(uint32_t argc, void* argv, void* functionPointer);
+#endif
 
 #pragma mark -
 #pragma mark Functions
@@ -54,52 +110,68 @@ extern void* makeDynamicCallWithIntList(uint32_t argc, void* argv, void* functio
 void SDMSTBuildLibraryInfo(SDMMOLibrarySymbolTable *libTable) {
 	if (libTable->libInfo == NULL) {
 		libTable->libInfo = (struct SDMSTLibraryTableInfo *)calloc(0x1, sizeof(struct SDMSTLibraryTableInfo));
-		const struct mach_header *imageHeader;
-		if (libTable->couldLoad) {
-			uint32_t count = _dyld_image_count();
-			for (uint32_t i = 0x0; i < count; i++) {
-				if (strcmp(_dyld_get_image_name(i), libTable->libraryPath) == 0x0) {
-					libTable->libInfo->imageNumber = i;
-					break;
-				}
-			}
-			imageHeader = _dyld_get_image_header(libTable->libInfo->imageNumber);
-		} else {
+		const struct mach_header *imageHeader = NULL;
+		struct SDMSTImageEntry image;
+		if (!libTable->couldLoad) {
 			imageHeader = (struct mach_header *)libTable->libraryHandle;
+		} else if (SDMSTImageMapFindPath(SDMSTImageMapShared(), libTable->libraryPath, libTable->libraryHandle, &image)) {
+			libTable->libInfo->imageNumber = image.imageIndex;
+			imageHeader = image.header;
+		}
+		if (imageHeader) {
+			libTable->libInfo->headerMagic = imageHeader->magic;
+			libTable->libInfo->arch = (struct SDMSTLibraryArchitecture){imageHeader->cputype, imageHeader->cpusubtype};
+			libTable->libInfo->is64bit = ((libTable->libInfo->headerMagic == MH_MAGIC_64 || libTable->libInfo->headerMagic == MH_CIGAM_64) ? true : false);
+			libTable->libInfo->mhOffset = (uintptr_t*)imageHeader;
 		}
-		libTable->libInfo->headerMagic = imageHeader->magic;
-		libTable->libInfo->arch = (struct SDMSTLibraryArchitecture){imageHeader->cputype, imageHeader->cpusubtype};
-		libTable->libInfo->is64bit = ((imageHeader->cputype == CPU_TYPE_X86_64 || imageHeader->cputype == CPU_TYPE_POWERPC64) && (libTable->libInfo->headerMagic == MH_MAGIC_64 || libTable->libInfo->headerMagic == MH_CIGAM_64) ? true : false);
-		libTable->libInfo->mhOffset = (uintptr_t*)imageHeader;
 	}
 	struct mach_header *libHeader = (struct mach_header *)((char*)libTable->libInfo->mhOffset);
-	if (libTable->libInfo->headerMagic == libHeader->magic) {
+	if (libHeader && libTable->libInfo->headerMagic == libHeader->magic) {
 		if (libTable->libInfo->symtabCommands == NULL) {
-			struct load_command *loadCmd = (struct load_command *)((char*)libTable->libInfo->mhOffset + (libTable->libInfo->is64bit ? sizeof(struct mach_header_64) : sizeof(struct mach_header)));
+			// Everything below comes from the image's command index, which is built and bounds-checked once per image.
+			struct SDMSTCommandIndex *index = SDMSTCommandIndexCreate(libHeader, SDMSTImageCommandsSize(libHeader));
+			libTable->libInfo->commandIndex = index;
 			libTable->libInfo->symtabCommands = (struct symtab_command *)calloc(0x1, sizeof(struct symtab_command));
 			libTable->libInfo->symtabCount = 0x0;
-			for (uint32_t i = 0x0; i < libHeader->ncmds; i++) {
-				if (loadCmd->cmd == LC_SYMTAB) {
-					libTable->libInfo->symtabCommands = realloc(libTable->libInfo->symtabCommands, (libTable->libInfo->symtabCount+1)*sizeof(struct symtab_command));
-					libTable->libInfo->symtabCommands[libTable->libInfo->symtabCount] = *(struct symtab_command *)loadCmd;
-					libTable->libInfo->symtabCount++;
-				}
-				if (loadCmd->cmd == (libTable->libInfo->is64bit ? LC_SEGMENT_64 : LC_SEGMENT)) {
-					struct SDMSTSegmentEntry *seg = (struct SDMSTSegmentEntry *)loadCmd;
-					if ((libTable->libInfo->textSeg == NULL) && !strncmp(SEG_TEXT,seg->segname,sizeof(seg->segname))) {
-						libTable->libInfo->textSeg = (struct SDMSTSegmentEntry *)seg;
-					} else if ((libTable->libInfo->linkSeg == NULL) && !strncmp(SEG_LINKEDIT,seg->segname,sizeof(seg->segname))) {
-						libTable->libInfo->linkSeg = (struct SDMSTSegmentEntry *)seg;
-					}
-				}
-				if (loadCmd->cmd == LC_LOAD_DYLIB) {
-					struct dylib_command *linkedLibrary = (struct dylib_command *)loadCmd;
-					if (loadCmd+linkedLibrary->dylib.name.offset) {
-						printf("%s\n",(char*)loadCmd+linkedLibrary->dylib.name.offset);
-					}
-				}
-				loadCmd = (struct load_command *)((char*)loadCmd + loadCmd->cmdsize);
+			for (struct SDMSTLoadCommandEntry *entry = SDMSTCommandFind(index, LC_SYMTAB); entry; entry = SDMSTCommandNext(index, entry)) {
+				libTable->libInfo->symtabCommands = realloc(libTable->libInfo->symtabCommands, (libTable->libInfo->symtabCount+1)*sizeof(struct symtab_command));
+				libTable->libInfo->symtabCommands[libTable->libInfo->symtabCount] = *(struct symtab_command *)entry->command;
+				libTable->libInfo->symtabCount++;
+			}
+			struct SDMSTSegmentInfo *textSegment = SDMSTSegmentNamed(index, SEG_TEXT);
+			struct SDMSTSegmentInfo *linkSegment = SDMSTSegmentNamed(index, SEG_LINKEDIT);
+			libTable->libInfo->textSeg = (textSegment ? (struct SDMSTSegmentEntry *)textSegment->command : NULL);
+			libTable->libInfo->linkSeg = (linkSegment ? (struct SDMSTSegmentEntry *)linkSegment->command : NULL);
+			// A standalone export trie takes precedence over the one LC_DYLD_INFO points at.
+			struct SDMSTLoadCommandEntry *exports = SDMSTCommandFind(index, LC_DYLD_EXPORTS_TRIE);
+			struct SDMSTLoadCommandEntry *dyldInfo = SDMSTCommandFind(index, LC_DYLD_INFO_ONLY);
+			if (dyldInfo == NULL)
+				dyldInfo = SDMSTCommandFind(index, LC_DYLD_INFO);
+			if (exports) {
+				libTable->libInfo->exportOffset = ((struct linkedit_data_command *)exports->command)->dataoff;
+				libTable->libInfo->exportSize = ((struct linkedit_data_command *)exports->command)->datasize;
+			} else if (dyldInfo) {
+				libTable->libInfo->exportOffset = ((struct dyld_info_command *)dyldInfo->command)->export_off;
+				libTable->libInfo->exportSize = ((struct dyld_info_command *)dyldInfo->command)->export_size;
+			}
+			struct SDMSTLoadCommandEntry *dysymtab = SDMSTCommandFind(index, LC_DYSYMTAB);
+			if (dysymtab) {
+				libTable->libInfo->indirectSymbolOffset = ((struct dysymtab_command *)dysymtab->command)->indirectsymoff;
+				libTable->libInfo->indirectSymbolCount = ((struct dysymtab_command *)dysymtab->command)->nindirectsyms;
 			}
+			struct SDMSTLoadCommandEntry *functionStarts = SDMSTCommandFind(index, LC_FUNCTION_STARTS);
+			if (functionStarts) {
+				libTable->libInfo->functionStartsOffset = ((struct linkedit_data_command *)functionStarts->command)->dataoff;
+				libTable->libInfo->functionStartsSize = ((struct linkedit_data_command *)functionStarts->command)->datasize;
+			}
+			// One slide for dyld-loaded and manually mapped images alike: where the header sits relative to __TEXT's vmaddr.
+			if (textSegment)
+				libTable->libInfo->vmSlide = (intptr_t)((uintptr_t)libTable->libInfo->mhOffset - (uintptr_t)textSegment->vmaddr);
+			// symoff/stroff are file offsets. A mapped file already has them relative to the header; a loaded image has
+			// __LINKEDIT at its vm distance from __TEXT, so the file offset is rebased onto that.
+			libTable->libInfo->linkeditBase = (char*)libTable->libInfo->mhOffset;
+			if (libTable->couldLoad && textSegment && linkSegment)
+				libTable->libInfo->linkeditBase += (intptr_t)((linkSegment->vmaddr - textSegment->vmaddr) - linkSegment->fileoff);
 		}
 	}
 }
@@ -111,122 +183,712 @@ int SDMSTCompareTableEntries(const void *entry1, const void *entry2) {
 	return -0;
 }
 
-void SDMSTGenerateSortedSymbolTable(struct SDMMOLibrarySymbolTable *libTable) {
-	if (libTable->table == NULL) {
-		void* symbolAddress = 0x0;
-		libTable->table = (struct SDMSTMachOSymbol *)calloc(0x1, sizeof(struct SDMSTMachOSymbol));
-		libTable->symbolCount = 0x0;
-		if (libTable->libInfo == NULL)
-			SDMSTBuildLibraryInfo(libTable);
-		for (uint32_t i = 0x0; i < libTable->libInfo->symtabCount; i++) {
-			struct symtab_command *cmd = (struct symtab_command *)(&(libTable->libInfo->symtabCommands[i]));
-			uint64_t fslide = 0x0, mslide = 0x0;
+void SDMSTAppendSymbol(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTSymbolSource *source, uint32_t tableNumber, uint32_t symbolNumber, uint64_t value, bool named, char *name, uint32_t nameLength) {
+	// Unnamed symbols are numbered by their place in the finished table, so they get their names when the sources are merged.
+	struct SDMSTMachOSymbol *aSymbol = &(source->symbols[source->count]);
+	aSymbol->tableNumber = tableNumber;
+	aSymbol->symbolNumber = symbolNumber;
+	aSymbol->offset = (void*)((uintptr_t)value + libTable->libInfo->vmSlide);
+	aSymbol->name = (named ? name : NULL);
+	aSymbol->nameLength = (named ? nameLength : 0x0);
+	aSymbol->isStub = !named;
+	source->count++;
+}
+
+char* SDMSTStreamWindowAt(struct SDMSTStreamWindow *window, uint64_t offset, uint64_t needed, uint64_t *available) {
+	if (offset < window->start || offset + needed > window->start + window->length) {
+		window->start = offset;
+		window->length = 0x0;
+		uint64_t wanted = (window->limit > offset ? window->limit - offset : 0x0);
+		if (wanted > window->size)
+			wanted = window->size;
+		ssize_t readSize = (wanted ? pread(window->fd, window->buffer, (size_t)wanted, (off_t)(window->base + offset)) : 0x0);
+		if (readSize > 0x0)
+			window->length = (uint64_t)readSize;
+		if (window->length < needed)
+			return NULL;
+	}
+	*available = window->start + window->length - offset;
+	return window->buffer + (offset - window->start);
+}
+
+void SDMSTStreamSymbolTable(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTSymbolSource *source, uint32_t tableNumber, struct symtab_command *cmd, uint64_t entrySize) {
+	// The window is split between nlist entries and strings; each half is refilled with pread at the first offset it
+	// does not cover, so nothing but the finished table and its names grows with the size of the binary.
+	struct SDMSTLibraryMapping *mapping = libTable->mapping;
+	uint64_t entryWindow = ((mapping->streamWindow >> 0x1) / entrySize) * entrySize;
+	if (entryWindow < entrySize)
+		entryWindow = entrySize;
+	uint64_t stringWindow = (mapping->streamWindow > entryWindow + 0x40 ? mapping->streamWindow - entryWindow : 0x40);
+	char *buffer = (char *)calloc((size_t)(entryWindow + stringWindow), sizeof(char));
+	struct SDMSTStreamWindow entries = {mapping->fd, mapping->fileOffset + cmd->symoff, (uint64_t)cmd->nsyms * entrySize, buffer, entryWindow, 0x0, 0x0};
+	struct SDMSTStreamWindow strings = {mapping->fd, mapping->fileOffset + cmd->stroff, cmd->strsize, buffer + entryWindow, stringWindow, 0x0, 0x0};
+	uint64_t namesSize = 0x0, namesCapacity = 0x0;
+	uint64_t swappedStart = UINT64_MAX;
+	for (uint32_t j = 0x0; j < cmd->nsyms; j++) {
+		uint64_t available = 0x0;
+		char *entryData = SDMSTStreamWindowAt(&entries, (uint64_t)j * entrySize, entrySize, &available);
+		if (entryData == NULL)
+			break;
+		// Each refill of a foreign-endian image's entry window is swapped in one pass; refills always start on an entry.
+		if (libTable->byteSwapped && entries.start != swappedStart) {
+			SDMSTSwapSymbolEntries(entries.buffer, entries.length / entrySize, libTable->libInfo->is64bit);
+			swappedStart = entries.start;
+		}
+		struct SDMSTSymbolTableListEntry entry;
+		memcpy(&entry, entryData, sizeof(struct SDMSTSymbolTableListEntry));
+		if (!(entry.n_type & N_STAB) && ((entry.n_type & N_TYPE) == N_SECT)) {
+			uint64_t value = 0x0;
 			if (libTable->libInfo->is64bit) {
-				struct SDMSTSeg64Data *textData = (struct SDMSTSeg64Data *)((char*)libTable->libInfo->textSeg + sizeof(struct SDMSTSegmentEntry));
-				struct SDMSTSeg64Data *linkData = (struct SDMSTSeg64Data *)((char*)libTable->libInfo->linkSeg + sizeof(struct SDMSTSegmentEntry));
-				fslide = (uint64_t)(linkData->vmaddr - textData->vmaddr) - linkData->fileoff;
-				mslide = (uint64_t)((char*)libTable->libInfo->mhOffset - textData->vmaddr);
+				memcpy(&value, entryData + sizeof(struct SDMSTSymbolTableListEntry), sizeof(uint64_t));
 			} else {
-				struct SDMSTSeg32Data *textData = (struct SDMSTSeg32Data *)((char*)libTable->libInfo->textSeg + sizeof(struct SDMSTSegmentEntry));
-				struct SDMSTSeg32Data *linkData = (struct SDMSTSeg32Data *)((char*)libTable->libInfo->linkSeg + sizeof(struct SDMSTSegmentEntry));
-				fslide = (uint64_t)(linkData->vmaddr - textData->vmaddr) - linkData->fileoff;
-				mslide = (uint64_t)((char*)libTable->libInfo->mhOffset - textData->vmaddr);
+				uint32_t value32;
+				memcpy(&value32, entryData + sizeof(struct SDMSTSymbolTableListEntry), sizeof(uint32_t));
+				value = value32;
 			}
-			struct SDMSTSymbolTableListEntry *entry = (struct SDMSTSymbolTableListEntry *)((char*)libTable->libInfo->mhOffset + cmd->symoff + fslide);
-			for (uint32_t j = 0x0; j < cmd->nsyms; j++) {
-				if (!(entry->n_type & N_STAB) && ((entry->n_type & N_TYPE) == N_SECT)) {
-					char *strTable = (char*)libTable->libInfo->mhOffset + cmd->stroff + fslide;
-					if (libTable->libInfo->is64bit) {
-						uint64_t *n_value = (uint64_t*)((char*)entry + sizeof(struct SDMSTSymbolTableListEntry));
-						symbolAddress = (void*)*n_value;
-					} else {
-						uint32_t *n_value = (uint32_t*)((char*)entry + sizeof(struct SDMSTSymbolTableListEntry));
-						symbolAddress = (void*)*n_value;
-					}
-					libTable->table = realloc(libTable->table, sizeof(struct SDMSTMachOSymbol)*(libTable->symbolCount+0x1));
-					struct SDMSTMachOSymbol *aSymbol = (struct SDMSTMachOSymbol *)calloc(0x1, sizeof(struct SDMSTMachOSymbol));
-					aSymbol->tableNumber = i;
-					aSymbol->symbolNumber = j;
-					aSymbol->offset = (void*)symbolAddress + (libTable->couldLoad ? _dyld_get_image_vmaddr_slide(libTable->libInfo->imageNumber) : 0);
-					if (entry->n_un.n_strx && entry->n_un.n_strx < cmd->strsize) {
-						aSymbol->name = ((char *)strTable + entry->n_un.n_strx);
-						aSymbol->isStub = false;
-					} else {
-						aSymbol->name = calloc(14+((libTable->symbolCount==0) ? 1 : (uint32_t)log10(libTable->symbolCount) + 1), sizeof(char));
-						sprintf(aSymbol->name, "__sdmst_stub_%i", libTable->symbolCount);
-						aSymbol->isStub = true;
+			bool named = (entry.n_un.n_strx && entry.n_un.n_strx < cmd->strsize);
+			char *name = NULL;
+			uint64_t nameLength = 0x0;
+			if (named) {
+				// Names are copied into one buffer per symtab and stored as offsets until the symtab is finished, since the buffer moves as it grows.
+				uint64_t nameOffset = namesSize;
+				bool terminated = false;
+				char *chunk;
+				while (!terminated && (chunk = SDMSTStreamWindowAt(&strings, entry.n_un.n_strx + nameLength, 0x1, &available))) {
+					uint64_t chunkLength = strnlen(chunk, (size_t)available);
+					terminated = (chunkLength < available);
+					if (namesSize + chunkLength + 0x1 > namesCapacity) {
+						namesCapacity = (namesSize + chunkLength + 0x1) * 0x2;
+						source->names = realloc(source->names, (size_t)namesCapacity);
 					}
-					libTable->table[libTable->symbolCount] = *aSymbol;
-					libTable->symbolCount++;
+					memcpy(source->names + namesSize, chunk, (size_t)chunkLength);
+					namesSize += chunkLength;
+					nameLength += chunkLength;
+				}
+				if (namesSize + 0x1 > namesCapacity) {
+					namesCapacity = (namesSize + 0x1) * 0x2;
+					source->names = realloc(source->names, (size_t)namesCapacity);
 				}
-				entry = (struct SDMSTSymbolTableListEntry *)((char*)entry + (sizeof(struct SDMSTSymbolTableListEntry) + (libTable->libInfo->is64bit ? sizeof(uint64_t) : sizeof(uint32_t))));
+				source->names[namesSize++] = '\0';
+				name = (char*)(uintptr_t)nameOffset;
+			}
+			SDMSTAppendSymbol(libTable, source, tableNumber, j, value, named, name, (uint32_t)nameLength);
+		}
+	}
+	for (uint32_t i = 0x0; i < source->count; i++)
+		if (!source->symbols[i].isStub)
+			source->symbols[i].name = source->names + (uintptr_t)source->symbols[i].name;
+	free(buffer);
+}
+
+const uint8_t* SDMSTLinkeditData(struct SDMMOLibrarySymbolTable *libTable, uint32_t offset, uint32_t size, bool *owned) {
+	// __LINKEDIT blobs are read in place when the image is mapped or loaded; a streamed image reads them into a buffer
+	// the caller frees when owned comes back true.
+	const uint8_t *data = NULL;
+	*owned = false;
+	if (libTable->libInfo == NULL || size == 0x0)
+		return NULL;
+	if (libTable->mapping && libTable->mapping->streamWindow) {
+		uint8_t *buffer = (uint8_t *)calloc(size, sizeof(uint8_t));
+		if (pread(libTable->mapping->fd, buffer, size, (off_t)(libTable->mapping->fileOffset + offset)) == (ssize_t)size) {
+			data = buffer;
+			*owned = true;
+		} else {
+			free(buffer);
+		}
+	} else if (SDMSTMapLibraryRange(libTable, libTable->libInfo->linkeditBase + offset, size, true)) {
+		data = (const uint8_t *)(libTable->libInfo->linkeditBase + offset);
+	}
+	return data;
+}
+
+void SDMSTBuildFunctionStarts(struct SDMMOLibrarySymbolTable *libTable) {
+	// LC_FUNCTION_STARTS is a zero-terminated list of ULEB128 deltas, the first one from the start of __TEXT.
+	bool owned = false;
+	const uint8_t *data = (libTable->libInfo->textSeg ? SDMSTLinkeditData(libTable, libTable->libInfo->functionStartsOffset, libTable->libInfo->functionStartsSize, &owned) : NULL);
+	if (data) {
+		struct SDMSTSeg64Data textData = SDMSTSegmentData(libTable->libInfo->textSeg, libTable->libInfo->is64bit);
+		const uint8_t *cursor = data, *end = data + libTable->libInfo->functionStartsSize;
+		uintptr_t address = (uintptr_t)textData.vmaddr + libTable->libInfo->vmSlide;
+		uint64_t delta;
+		libTable->functionStarts = (uintptr_t *)calloc(libTable->libInfo->functionStartsSize + 0x1, sizeof(uintptr_t));
+		while (SDMSTReadULEB128(&cursor, end, &delta) && delta) {
+			address += (uintptr_t)delta;
+			libTable->functionStarts[libTable->functionStartCount++] = address;
+		}
+		libTable->functionStarts = realloc(libTable->functionStarts, sizeof(uintptr_t) * (libTable->functionStartCount + 0x1));
+		if (owned)
+			free((void *)data);
+	}
+}
+
+void SDMSTAddUnnamedFunctions(struct SDMMOLibrarySymbolTable *libTable) {
+	// Both lists are sorted, so one merge pass finds the function starts no symbol begins at; each gets a synthetic
+	// symbol so stripped code still has extents that stop at the next real function.
+	uint32_t named = libTable->symbolCount, missing = 0x0;
+	for (uint32_t i = 0x0, j = 0x0; i < libTable->functionStartCount; i++) {
+		while (j < named && (uintptr_t)libTable->table[j].offset < libTable->functionStarts[i])
+			j++;
+		if (j == named || (uintptr_t)libTable->table[j].offset != libTable->functionStarts[i])
+			missing++;
+	}
+	if (missing) {
+		libTable->table = realloc(libTable->table, sizeof(struct SDMSTMachOSymbol) * (named + missing + 0x1));
+		for (uint32_t i = 0x0, j = 0x0; i < libTable->functionStartCount; i++) {
+			while (j < named && (uintptr_t)libTable->table[j].offset < libTable->functionStarts[i])
+				j++;
+			if (j == named || (uintptr_t)libTable->table[j].offset != libTable->functionStarts[i]) {
+				struct SDMSTMachOSymbol *aSymbol = &(libTable->table[libTable->symbolCount]);
+				unsigned long long vmaddr = (unsigned long long)(libTable->functionStarts[i] - libTable->libInfo->vmSlide);
+				aSymbol->tableNumber = kSDMSTSyntheticTable;
+				aSymbol->symbolNumber = i;
+				aSymbol->offset = (void*)libTable->functionStarts[i];
+				aSymbol->nameLength = (uint32_t)snprintf(NULL, 0x0, "__sdmst_function_%llx", vmaddr);
+				aSymbol->name = calloc(aSymbol->nameLength + 0x1, sizeof(char));
+				snprintf(aSymbol->name, aSymbol->nameLength + 0x1, "__sdmst_function_%llx", vmaddr);
+				aSymbol->isStub = true;
+				libTable->symbolCount++;
 			}
 		}
 		qsort(libTable->table, libTable->symbolCount, sizeof(struct SDMSTMachOSymbol), SDMSTCompareTableEntries);
 	}
 }
 
-struct SDMMOLibrarySymbolTable* SDMSTLoadLibrary(char *path) {
+char* SDMSTSymbolTableBase(struct SDMMOLibrarySymbolTable *libTable, uint32_t tableNumber) {
+	// A shared cache's local symbols are appended after the image's own LC_SYMTABs and carry offsets into their own region.
+	if (libTable->libInfo->localSymbolsBase && tableNumber + 0x1 == libTable->libInfo->symtabCount)
+		return libTable->libInfo->localSymbolsBase;
+	return libTable->libInfo->linkeditBase;
+}
+
+void SDMSTReadSymbolSource(struct SDMMOLibrarySymbolTable *libTable, uint32_t tableNumber) {
+	struct SDMSTSymbolSource *source = &(libTable->symbolSources->sources[tableNumber]);
+	struct symtab_command *cmd = (struct symtab_command *)(&(libTable->libInfo->symtabCommands[tableNumber]));
+	char *base = SDMSTSymbolTableBase(libTable, tableNumber);
+	uint64_t entrySize = sizeof(struct SDMSTSymbolTableListEntry) + (libTable->libInfo->is64bit ? sizeof(uint64_t) : sizeof(uint32_t));
+	// Room for every entry up front; the unused tail is trimmed once the symtab is read.
+	source->symbols = (struct SDMSTMachOSymbol *)calloc((uint64_t)cmd->nsyms + 0x1, sizeof(struct SDMSTMachOSymbol));
+	source->count = 0x0;
+	if (libTable->mapping && libTable->mapping->streamWindow) {
+		SDMSTStreamSymbolTable(libTable, source, tableNumber, cmd, entrySize);
+	} else if ((libTable->couldLoad || ((uint64_t)cmd->symoff + (uint64_t)cmd->nsyms * entrySize <= libTable->librarySize && (uint64_t)cmd->stroff + cmd->strsize <= libTable->librarySize)) && SDMSTMapLibraryRange(libTable, base + cmd->symoff, (uint64_t)cmd->nsyms * entrySize, true) && SDMSTMapLibraryRange(libTable, base + cmd->stroff, cmd->strsize, true)) {
+		struct SDMSTSymbolTableListEntry *entry = (struct SDMSTSymbolTableListEntry *)(base + cmd->symoff);
+		// A foreign-endian nlist array is swapped into a native copy in one pass; names still come from the mapping.
+		char *swappedEntries = NULL;
+		if (libTable->byteSwapped) {
+			swappedEntries = (char *)calloc((size_t)((uint64_t)cmd->nsyms * entrySize + 0x1), sizeof(char));
+			memcpy(swappedEntries, entry, (size_t)((uint64_t)cmd->nsyms * entrySize));
+			SDMSTSwapSymbolEntries(swappedEntries, cmd->nsyms, libTable->libInfo->is64bit);
+			entry = (struct SDMSTSymbolTableListEntry *)swappedEntries;
+		}
+		char *strTable = base + cmd->stroff;
+		for (uint32_t j = 0x0; j < cmd->nsyms; j++) {
+			if (!(entry->n_type & N_STAB) && ((entry->n_type & N_TYPE) == N_SECT)) {
+				uint64_t value = (libTable->libInfo->is64bit ? *(uint64_t*)((char*)entry + sizeof(struct SDMSTSymbolTableListEntry)) : *(uint32_t*)((char*)entry + sizeof(struct SDMSTSymbolTableListEntry)));
+				if (entry->n_un.n_strx && entry->n_un.n_strx < cmd->strsize) {
+					char *name = ((char *)strTable + entry->n_un.n_strx);
+					SDMSTAppendSymbol(libTable, source, tableNumber, j, value, true, name, (uint32_t)SDMSTStringLength(name));
+				} else {
+					SDMSTAppendSymbol(libTable, source, tableNumber, j, value, false, NULL, 0x0);
+				}
+			}
+			entry = (struct SDMSTSymbolTableListEntry *)((char*)entry + entrySize);
+		}
+		free(swappedEntries);
+	}
+	source->symbols = realloc(source->symbols, sizeof(struct SDMSTMachOSymbol) * (source->count + 0x1));
+}
+
+void SDMSTCreateSymbolSources(struct SDMMOLibrarySymbolTable *libTable, bool lazy) {
+	// One source per LC_SYMTAB (plus a shared cache's local symbols), each read at most once.
+	if (libTable->symbolSources == NULL) {
+		libTable->symbolSources = (struct SDMSTSymbolSources *)calloc(0x1, sizeof(struct SDMSTSymbolSources));
+		pthread_mutex_init(&(libTable->symbolSources->lock), NULL);
+		libTable->symbolSources->lazy = lazy;
+		libTable->symbolSources->count = libTable->libInfo->symtabCount;
+		libTable->symbolSources->sources = (struct SDMSTSymbolSource *)calloc(libTable->symbolSources->count + 0x1, sizeof(struct SDMSTSymbolSource));
+	}
+}
+
+struct SDMSTSymbolSource* SDMSTSymbolSourceAt(struct SDMMOLibrarySymbolTable *libTable, uint32_t tableNumber) {
+	struct SDMSTSymbolSources *sources = libTable->symbolSources;
+	struct SDMSTSymbolSource *source = &(sources->sources[tableNumber]);
+	if (!__atomic_load_n(&(source->ready), __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&(sources->lock));
+		if (!source->ready) {
+			SDMSTReadSymbolSource(libTable, tableNumber);
+			__atomic_store_n(&(source->ready), true, __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&(sources->lock));
+	}
+	return source;
+}
+
+void SDMSTMergeSymbolSources(struct SDMMOLibrarySymbolTable *libTable) {
+	// Called with the sources locked. Sources are concatenated in load command order, so the finished table is the same
+	// whether or not some of them were read earlier by a lookup.
+	struct SDMSTSymbolSources *sources = libTable->symbolSources;
+	uint64_t total = 0x0;
+	for (uint32_t i = 0x0; i < sources->count; i++) {
+		if (!sources->sources[i].ready) {
+			SDMSTReadSymbolSource(libTable, i);
+			__atomic_store_n(&(sources->sources[i].ready), true, __ATOMIC_RELEASE);
+		}
+		total += sources->sources[i].count;
+	}
+	libTable->table = (struct SDMSTMachOSymbol *)calloc(total + 0x1, sizeof(struct SDMSTMachOSymbol));
+	libTable->symbolCount = 0x0;
+	for (uint32_t i = 0x0; i < sources->count; i++) {
+		struct SDMSTSymbolSource *source = &(sources->sources[i]);
+		for (uint32_t j = 0x0; j < source->count; j++) {
+			struct SDMSTMachOSymbol *aSymbol = &(libTable->table[libTable->symbolCount]);
+			*aSymbol = source->symbols[j];
+			if (aSymbol->isStub) {
+				aSymbol->name = calloc(14+((libTable->symbolCount==0) ? 1 : (uint32_t)log10(libTable->symbolCount) + 1), sizeof(char));
+				sprintf(aSymbol->name, "__sdmst_stub_%i", libTable->symbolCount);
+				aSymbol->nameLength = (uint32_t)SDMSTStringLength(aSymbol->name);
+			}
+			libTable->symbolCount++;
+		}
+		// A lazy table may still have lookups scanning its sources, so those keep their symbols until release.
+		if (!sources->lazy) {
+			free(source->symbols);
+			source->symbols = NULL;
+			source->count = 0x0;
+		}
+	}
+	qsort(libTable->table, libTable->symbolCount, sizeof(struct SDMSTMachOSymbol), SDMSTCompareTableEntries);
+	SDMSTBuildFunctionStarts(libTable);
+	SDMSTAddUnnamedFunctions(libTable);
+	SDMSTBuildAddressIndex(libTable);
+}
+
+bool SDMSTMaterializeSymbols(struct SDMMOLibrarySymbolTable *libTable) {
+	struct SDMSTSymbolSources *sources = (libTable ? libTable->symbolSources : NULL);
+	if (sources && !__atomic_load_n(&(sources->ready), __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&(sources->lock));
+		if (!sources->ready) {
+			SDMSTMergeSymbolSources(libTable);
+			__atomic_store_n(&(sources->ready), true, __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&(sources->lock));
+	}
+	return (libTable && libTable->table != NULL);
+}
+
+struct SDMSTStubIndex* SDMSTLoadStubIndex(struct SDMMOLibrarySymbolTable *libTable) {
+	// Built at most once under the table's lock and published with a release store, so concurrent first lookups through
+	// stubs share one index.
+	struct SDMSTSymbolSources *sources = (libTable ? libTable->symbolSources : NULL);
+	if (sources == NULL)
+		return NULL;
+	struct SDMSTStubIndex *index = __atomic_load_n(&(libTable->stubIndex), __ATOMIC_ACQUIRE);
+	if (index == NULL) {
+		pthread_mutex_lock(&(sources->lock));
+		index = libTable->stubIndex;
+		if (index == NULL) {
+			index = SDMSTStubIndexCreate(libTable);
+			__atomic_store_n(&(libTable->stubIndex), index, __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&(sources->lock));
+	}
+	return index;
+}
+
+bool SDMSTSyntheticNameSuffix(char *symbolName, uint64_t length) {
+	// Whether the name could end one of the names given to unnamed symbols or bare function starts, which only exist
+	// once the table is built: a run of hex digits after the tail of one of their prefixes.
+	uint64_t prefixLength = length;
+	while (prefixLength && isxdigit((unsigned char)symbolName[prefixLength - 0x1]))
+		prefixLength--;
+	return (SDMSTStringHasSuffix("__sdmst_stub_", 0xd, symbolName, prefixLength) || SDMSTStringHasSuffix("__sdmst_function_", 0x11, symbolName, prefixLength));
+}
+
+void* SDMSTSymbolSourcesLookup(struct SDMMOLibrarySymbolTable *libTable, char *symbolName, uint64_t length) {
+	// Every symtab is read and the lowest addressed match wins, as in the built table; unnamed symbols and synthetic
+	// function starts are left out here, since SDMSTSymbolLookup builds the table for any name that could match them.
+	struct SDMSTMachOSymbol *match = NULL;
+	for (uint32_t i = 0x0; i < libTable->symbolSources->count; i++) {
+		struct SDMSTSymbolSource *source = SDMSTSymbolSourceAt(libTable, i);
+		for (uint32_t j = 0x0; j < source->count; j++) {
+			struct SDMSTMachOSymbol *symbol = &(source->symbols[j]);
+			if (!symbol->isStub && (match == NULL || symbol->offset < match->offset) && SDMSTStringHasSuffix(symbol->name, symbol->nameLength, symbolName, length))
+				match = symbol;
+		}
+	}
+	return (match ? match->offset : NULL);
+}
+
+void SDMSTGenerateSortedSymbolTable(struct SDMMOLibrarySymbolTable *libTable) {
+	if (libTable->table == NULL) {
+		if (libTable->libInfo == NULL)
+			SDMSTBuildLibraryInfo(libTable);
+		SDMSTCreateSymbolSources(libTable, false);
+		SDMSTMaterializeSymbols(libTable);
+	}
+}
+
+uint32_t SDMSTSymbolRanges(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTAddressRange **ranges) {
+	// Every non-empty section, and any segment without sections, as slid ranges: a symbol never extends past the one it
+	// starts in, so an address past the end of a section or of the image does not fall to the last symbol before it.
+	struct SDMSTCommandIndex *index = (libTable->libInfo ? libTable->libInfo->commandIndex : NULL);
+	uint32_t count = 0x0;
+	*ranges = NULL;
+	if (index) {
+		*ranges = (struct SDMSTAddressRange *)calloc(index->sectionCount + index->segmentCount + 0x1, sizeof(struct SDMSTAddressRange));
+		for (uint32_t i = 0x0; i < index->segmentCount; i++) {
+			struct SDMSTSegmentInfo *segment = &(index->segments[i]);
+			if (segment->sectionCount == 0x0 && segment->vmsize)
+				(*ranges)[count++] = (struct SDMSTAddressRange){(uintptr_t)segment->vmaddr + libTable->libInfo->vmSlide, (uintptr_t)(segment->vmaddr + segment->vmsize) + libTable->libInfo->vmSlide};
+		}
+		for (uint32_t i = 0x0; i < index->sectionCount; i++) {
+			struct SDMSTSectionInfo *section = &(index->sections[i]);
+			if (section->size)
+				(*ranges)[count++] = (struct SDMSTAddressRange){(uintptr_t)section->address + libTable->libInfo->vmSlide, (uintptr_t)(section->address + section->size) + libTable->libInfo->vmSlide};
+		}
+	}
+	return count;
+}
+
+void SDMSTBuildAddressIndex(struct SDMMOLibrarySymbolTable *libTable) {
+	if (libTable->addressIndex == NULL) {
+		uintptr_t *offsets = (uintptr_t *)calloc(libTable->symbolCount + 0x1, sizeof(uintptr_t));
+		for (uint32_t i = 0x0; i < libTable->symbolCount; i++)
+			offsets[i] = (uintptr_t)libTable->table[i].offset;
+		struct SDMSTAddressIndex *addressIndex = SDMSTAddressIndexCreate(offsets, libTable->symbolCount);
+		struct SDMSTAddressRange *ranges = NULL;
+		uint32_t rangeCount = SDMSTSymbolRanges(libTable, &ranges);
+		SDMSTAddressIndexSetRanges(addressIndex, ranges, rangeCount);
+		libTable->addressIndex = addressIndex;
+	}
+}
+
+bool SDMSTMapLibraryRange(struct SDMMOLibrarySymbolTable *libTable, void* address, uint64_t length, bool sequential) {
+	if (libTable->couldLoad || libTable->mapping == NULL)
+		return true;
+	struct SDMSTLibraryMapping *mapping = libTable->mapping;
+	uint64_t start = (uint64_t)((char*)address - (char*)libTable->mappingBase);
+	if ((char*)address < (char*)libTable->mappingBase || start > libTable->librarySize || length > libTable->librarySize - start)
+		return false;
+	if (mapping->pages == NULL)
+		return true;
+	uint64_t firstPage = start / mapping->pageSize;
+	uint64_t endPage = (start + length + mapping->pageSize - 0x1) / mapping->pageSize;
+	bool mapped = true;
+	// Pages are mapped over the reservation in runs of not-yet-mapped pages, so every address handed out stays valid.
+	for (uint64_t page = firstPage; page < endPage && mapped;) {
+		if (__atomic_load_n(&mapping->pages[page >> 0x3], __ATOMIC_ACQUIRE) & (0x1 << (page & 0x7))) {
+			page++;
+			continue;
+		}
+		uint64_t runEnd = page + 0x1;
+		while (runEnd < endPage && !(__atomic_load_n(&mapping->pages[runEnd >> 0x3], __ATOMIC_ACQUIRE) & (0x1 << (runEnd & 0x7))))
+			runEnd++;
+		char *runStart = (char*)libTable->mappingBase + page * mapping->pageSize;
+		size_t runSize = (size_t)((runEnd - page) * mapping->pageSize);
+		if (runEnd * mapping->pageSize > libTable->librarySize)
+			runSize = (size_t)(libTable->librarySize - page * mapping->pageSize);
+		mapped = (mmap(runStart, runSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, mapping->fd, (off_t)(mapping->fileOffset + page * mapping->pageSize)) != MAP_FAILED);
+		for (; mapped && page < runEnd; page++)
+			__atomic_fetch_or(&mapping->pages[page >> 0x3], (uint8_t)(0x1 << (page & 0x7)), __ATOMIC_RELEASE);
+	}
+	if (mapped && sequential && endPage > firstPage) {
+		char *rangeStart = (char*)libTable->mappingBase + firstPage * mapping->pageSize;
+		size_t rangeSize = (size_t)((endPage - firstPage) * mapping->pageSize);
+		if (endPage * mapping->pageSize > libTable->librarySize)
+			rangeSize = (size_t)(libTable->librarySize - firstPage * mapping->pageSize);
+		madvise(rangeStart, rangeSize, MADV_SEQUENTIAL);
+		madvise(rangeStart, rangeSize, MADV_WILLNEED);
+	}
+	return mapped;
+}
+
+bool SDMSTSwapLibraryCommands(struct SDMMOLibrarySymbolTable *libTable, void* header, uint64_t commandsSize) {
+	// A foreign-endian image has its header and load commands put in host order once, right where they were read or
+	// mapped, and is marked so its symbol tables are swapped as they are read. Mapped pages are private copies once
+	// written, and stay writable since a neighbouring slice sharing the page may be swapped at the same time.
+	uint32_t magic = ((struct mach_header *)header)->magic;
+	if (magic != MH_CIGAM && magic != MH_CIGAM_64)
+		return true;
+	if (libTable->mapping && !libTable->mapping->streamWindow) {
+		uintptr_t pageMask = (uintptr_t)libTable->mapping->pageSize - 0x1;
+		uintptr_t start = (uintptr_t)header & ~pageMask;
+		uintptr_t end = ((uintptr_t)header + (uintptr_t)commandsSize + pageMask) & ~pageMask;
+		if (mprotect((void*)start, (size_t)(end - start), PROT_READ | PROT_WRITE) != 0x0)
+			return false;
+	}
+	libTable->byteSwapped = SDMSTSwapImageCommands(header, commandsSize);
+	return libTable->byteSwapped;
+}
+
+void* SDMSTMapLibrarySlice(struct SDMMOLibrarySymbolTable *table, char *path, struct SDMSTLoadOptions *options) {
+	void* handle = NULL;
+	int fd = open(path, O_RDONLY);
+	struct stat fs;
+	table->loadStatus = kSDMSTLoadOpenFailed;
+	if (fd >= 0x0 && fstat(fd, &fs) == 0x0) {
+		struct SDMSTFatSlice *slices = NULL;
+		uint32_t sliceCount = SDMSTReadSlices(fd, (uint64_t)fs.st_size, &slices);
+		int32_t selected = SDMSTSelectSlice(slices, sliceCount, (options ? options->arch.type : 0x0), (options ? options->arch.subtype : 0x0));
+		// Failures are reported only through loadStatus; a file without the requested architecture is kSDMSTLoadNoSlice.
+		table->loadStatus = (sliceCount ? (selected >= 0x0 ? kSDMSTLoadMapFailed : kSDMSTLoadNoSlice) : kSDMSTLoadNotMachO);
+		if (selected >= 0x0 && options && options->streamWindow) {
+			handle = SDMSTReadLibraryCommands(table, fd, &(slices[selected]), options->streamWindow);
+			if (handle)
+				fd = -0x1;
+		} else if (selected >= 0x0) {
+			// The chosen slice only gets an address range reserved up front; its file offset is rounded down to a page so
+			// later fixed mappings line up. The header and load commands are mapped now, __LINKEDIT ranges once the symbol
+			// tables are read, and code only when disassembly asks for it.
+			uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+			uint64_t mapOffset = slices[selected].offset & ~(pageSize - 0x1);
+			uint64_t mapSize = slices[selected].size + (slices[selected].offset - mapOffset);
+			void* reservation = (mapSize <= SIZE_MAX ? mmap(NULL, (size_t)mapSize, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0x0) : MAP_FAILED);
+			if (reservation != MAP_FAILED) {
+				table->mappingBase = reservation;
+				table->librarySize = mapSize;
+				table->mapping = (struct SDMSTLibraryMapping *)calloc(0x1, sizeof(struct SDMSTLibraryMapping));
+				table->mapping->fd = fd;
+				table->mapping->fileOffset = mapOffset;
+				table->mapping->pageSize = pageSize;
+				table->mapping->pages = (uint8_t *)calloc((size_t)((mapSize / pageSize + 0x8) >> 0x3), sizeof(uint8_t));
+				fd = -0x1;
+				handle = (char*)reservation + (slices[selected].offset - mapOffset);
+				bool mapped = SDMSTMapLibraryRange(table, handle, sizeof(struct mach_header_64), false);
+				if (mapped) {
+					uint64_t commandsSize = SDMSTImageCommandsSize((struct mach_header *)handle);
+					mapped = (commandsSize && SDMSTMapLibraryRange(table, handle, commandsSize, false) && SDMSTSwapLibraryCommands(table, handle, commandsSize));
+				}
+				if (!mapped)
+					handle = NULL;
+			}
+		}
+		free(slices);
+	}
+	if (fd >= 0x0)
+		close(fd);
+	return handle;
+}
+
+void* SDMSTReadLibraryCommands(struct SDMMOLibrarySymbolTable *table, int fd, struct SDMSTFatSlice *slice, uint32_t streamWindow) {
+	// Streaming keeps only the header and load commands in memory; the symbol and string tables are read through a
+	// bounded pread window while the table is built, so the slice is never mapped and may be larger than the address space.
+	void* handle = NULL;
+	struct mach_header_64 header;
+	if (slice->size >= sizeof(struct mach_header) && pread(fd, &header, sizeof(struct mach_header_64), (off_t)slice->offset) >= (ssize_t)sizeof(struct mach_header)) {
+		uint64_t commandsSize = SDMSTImageCommandsSize((struct mach_header *)&header);
+		if (commandsSize && commandsSize <= slice->size) {
+			char *commands = (char *)calloc((size_t)commandsSize, sizeof(char));
+			if (pread(fd, commands, (size_t)commandsSize, (off_t)slice->offset) == (ssize_t)commandsSize && SDMSTSwapLibraryCommands(table, commands, commandsSize)) {
+				table->mappingBase = commands;
+				table->librarySize = commandsSize;
+				table->mapping = (struct SDMSTLibraryMapping *)calloc(0x1, sizeof(struct SDMSTLibraryMapping));
+				table->mapping->fd = fd;
+				table->mapping->fileOffset = slice->offset;
+				table->mapping->streamWindow = (streamWindow < 0x200 ? 0x200 : streamWindow);
+				handle = commands;
+			} else {
+				free(commands);
+			}
+		}
+	}
+	return handle;
+}
+
+struct SDMMOLibrarySymbolTable* SDMSTLoadLibraryWithOptions(char *path, struct SDMSTLoadOptions *options) {
 	struct SDMMOLibrarySymbolTable *table = (struct SDMMOLibrarySymbolTable *)calloc(0x1, sizeof(struct SDMMOLibrarySymbolTable));
-	void* handle = dlopen(path, RTLD_LOCAL);
-	if (!handle) {
+	// dyld only ever loads the host slice, so an explicit request for another architecture goes straight to the manual map,
+	// as does a streaming load, which must not map the image at all, and a file-only load, which must not run the image's
+	// initializers or see an older copy dyld already has loaded from the same path.
+	void* handle = NULL;
+#ifdef __APPLE__
+	bool useDyld = (options == NULL || ((options->arch.type == 0x0 || options->arch.type == SDMSTHostCPUType()) && options->streamWindow == 0x0 && !options->fileOnly));
+	if (useDyld)
+		handle = dlopen(path, RTLD_LOCAL);
+	if (useDyld && !handle) {
 		printf("[%s] Unable to load library: %s\n", path, dlerror());
 		printf("Attempting to manually load and map...\n");
-		table->couldLoad = FALSE;
-		struct stat fs;
-		stat(path, &fs);
-		int fd = open(path, O_RDONLY);
-		uint32_t header = 0xdeadbeef;
-		read(fd, &header, sizeof(uint32_t));
-		uint32_t size = fs.st_size;
-		uint32_t offset = 0;
-		if (header == 0xbebafeca) {
-			size -= 4096;
-			offset += 4096;
-		}
-		handle = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, offset);
-		close(fd);
-		table->librarySize = 0;
+	}
+#endif
+#ifdef __APPLE__
+	// A path dyld resolved somewhere the image map cannot follow must not be read through some other image's header; the
+	// file is mapped instead.
+	if (handle && !SDMSTImageMapFindPath(SDMSTImageMapShared(), path, handle, NULL)) {
+		dlclose(handle);
+		handle = NULL;
+	}
+#endif
+	if (!handle) {
+		// Without dyld (or when it declines the image) the file itself is the image: everything is read from the mapping.
+		table->couldLoad = false;
+		handle = SDMSTMapLibrarySlice(table, path, options);
 	} else {
-		table->couldLoad = TRUE;
+		table->couldLoad = true;
 		table->librarySize = 0;
 	}
 	if (handle) {
+		table->loadStatus = kSDMSTLoadOK;
 		table->libraryPath = path;
 		table->libraryHandle = handle;
 		table->libInfo = NULL;
 		table->table = NULL;
 		table->symbolCount = 0x0;
 		SDMSTBuildLibraryInfo(table);
+		// A cache hit skips the symbol tables entirely; a miss generates them as usual and leaves an entry for next time,
+		// unless the caller asked for them to be read on first use.
+		char *cacheDirectory = (options && options->cacheDirectory ? options->cacheDirectory : getenv(kSDMSTIndexCacheEnvironment));
+		if (cacheDirectory && SDMSTIndexCacheLoad(table, cacheDirectory)) {
+			// The cached table is already complete; its sources are created ready so the table still has its lock.
+			SDMSTCreateSymbolSources(table, false);
+			table->symbolSources->ready = true;
+			SDMSTBuildAddressIndex(table);
+		} else if (options && options->lazySymbols) {
+			SDMSTCreateSymbolSources(table, true);
+		} else {
+			SDMSTGenerateSortedSymbolTable(table);
+			if (cacheDirectory)
+				SDMSTIndexCacheStore(table, cacheDirectory);
+		}
+	}
+	return table;
+}
+
+struct SDMMOLibrarySymbolTable* SDMSTLoadMappedImage(char *path, void* header, void* linkeditBase, void* fileBase, uint64_t fileSize, struct SDMSTLibraryMapping *mapping, struct symtab_command *localSymbols, void* localSymbolsBase) {
+	// An image inside a larger file another owner has mapped, such as a dyld shared cache or one slice of a universal
+	// binary. Symbol and string table offsets are relative to linkeditBase (the cache's start, or the slice's header),
+	// except for the extra localSymbols table, whose offsets are relative to localSymbolsBase; the mapping outlives the table.
+	struct SDMMOLibrarySymbolTable *table = (struct SDMMOLibrarySymbolTable *)calloc(0x1, sizeof(struct SDMMOLibrarySymbolTable));
+	table->couldLoad = false;
+	table->sharedMapping = true;
+	table->mappingBase = fileBase;
+	table->librarySize = fileSize;
+	table->mapping = mapping;
+	table->libraryPath = path;
+	table->loadStatus = kSDMSTLoadMapFailed;
+	bool mapped = SDMSTMapLibraryRange(table, header, sizeof(struct mach_header_64), false);
+	if (mapped) {
+		uint64_t commandsSize = SDMSTImageCommandsSize((struct mach_header *)header);
+		if (commandsSize == 0x0) {
+			table->loadStatus = kSDMSTLoadNotMachO;
+			mapped = false;
+		} else {
+			mapped = (SDMSTMapLibraryRange(table, header, commandsSize, false) && SDMSTSwapLibraryCommands(table, header, commandsSize));
+		}
+	}
+	if (mapped) {
+		table->loadStatus = kSDMSTLoadOK;
+		table->libraryHandle = header;
+		SDMSTBuildLibraryInfo(table);
+		table->libInfo->linkeditBase = (char*)linkeditBase;
+		if (localSymbols && localSymbols->nsyms) {
+			table->libInfo->symtabCommands = realloc(table->libInfo->symtabCommands, (table->libInfo->symtabCount+1)*sizeof(struct symtab_command));
+			table->libInfo->symtabCommands[table->libInfo->symtabCount] = *localSymbols;
+			table->libInfo->symtabCount++;
+			table->libInfo->localSymbolsBase = (char*)localSymbolsBase;
+		}
 		SDMSTGenerateSortedSymbolTable(table);
 	}
 	return table;
 }
 
+struct SDMMOLibrarySymbolTable* SDMSTLoadLibrary(char *path) {
+	return SDMSTLoadLibraryWithOptions(path, NULL);
+}
+
 bool SMDSTSymbolDemangleAndCompare(char *symFromTable, char *symbolName) {
 	bool matchesName = false;
-	if (symFromTable && symbolName) {
-		uint32_t tabSymLength = strlen(symFromTable);
-		uint32_t symLength = strlen(symbolName);
-		if (symLength <= tabSymLength) {
-			char *offset = strstr(symFromTable, symbolName);
-			if (offset) {
-				uint32_t originOffset = offset - symFromTable;
-				if (tabSymLength-originOffset == symLength)
-					matchesName = (strcmp(&symFromTable[originOffset], symbolName) == 0x0);
-			} 
-		}
-	}
+	if (symFromTable && symbolName)
+		matchesName = SDMSTStringHasSuffix(symFromTable, SDMSTStringLength(symFromTable), symbolName, SDMSTStringLength(symbolName));
 	return matchesName;
 }
 
 uint32_t SDMSTGetFunctionLength(struct SDMMOLibrarySymbolTable *libTable, void* functionPointer) {
-	uint32_t nextOffset = 0xffffffff;
-	for (uint32_t i = 0x0; i < libTable->symbolCount; i++)
-		if (functionPointer < libTable->table[i].offset)
-			if ((uint32_t)libTable->table[i].offset < nextOffset)
-				nextOffset = (uint32_t)libTable->table[i].offset;
-	return (nextOffset - (uint32_t)functionPointer);
+	SDMSTMaterializeSymbols(libTable);
+	uintptr_t nextOffset = (uintptr_t)functionPointer;
+	uint32_t next = SDMSTAddressIndexUpperBound(libTable->addressIndex, (uintptr_t)functionPointer);
+	void* functionEnd = NULL;
+	if (next < libTable->symbolCount) {
+		nextOffset = (uintptr_t)libTable->table[next].offset;
+	} else if (libTable->libInfo->textSeg) {
+		struct SDMSTSeg64Data textData = SDMSTSegmentData(libTable->libInfo->textSeg, libTable->libInfo->is64bit);
+		nextOffset = (uintptr_t)(textData.vmaddr + textData.vmsize) + libTable->libInfo->vmSlide;
+	}
+	if (SDMSTFunctionBounds(libTable, functionPointer, NULL, &functionEnd) && (uintptr_t)functionEnd < nextOffset)
+		nextOffset = (uintptr_t)functionEnd;
+	return (nextOffset > (uintptr_t)functionPointer ? (uint32_t)(nextOffset - (uintptr_t)functionPointer) : 0x0);
+}
+
+uint64_t SDMSTBuildPageIndex(struct SDMMOLibrarySymbolTable *libTable) {
+	uint64_t memory = 0x0;
+	if (SDMSTMaterializeSymbols(libTable) && libTable->addressIndex && libTable->libInfo->textSeg) {
+		struct SDMSTSeg64Data textData = SDMSTSegmentData(libTable->libInfo->textSeg, libTable->libInfo->is64bit);
+		uintptr_t textStart = (uintptr_t)textData.vmaddr + libTable->libInfo->vmSlide;
+		memory = SDMSTAddressIndexBuildPages(libTable->addressIndex, textStart, textStart + (uintptr_t)textData.vmsize);
+	}
+	return memory;
+}
+
+uint64_t SDMSTAddressIndexMemory(struct SDMMOLibrarySymbolTable *libTable, uint64_t *pageIndexMemory) {
+	SDMSTMaterializeSymbols(libTable);
+	if (pageIndexMemory)
+		*pageIndexMemory = SDMSTAddressIndexPagesMemorySize(libTable->addressIndex);
+	return SDMSTAddressIndexMemorySize(libTable->addressIndex);
+}
+
+bool SDMSTFunctionBounds(struct SDMMOLibrarySymbolTable *libTable, void* address, void** start, void** end) {
+	bool found = false;
+	if (SDMSTMaterializeSymbols(libTable) && libTable->functionStartCount) {
+		uint32_t low = 0x0, high = libTable->functionStartCount;
+		while (low < high) {
+			uint32_t middle = low + ((high - low) >> 1);
+			if (libTable->functionStarts[middle] <= (uintptr_t)address)
+				low = middle + 0x1;
+			else
+				high = middle;
+		}
+		if (low) {
+			uintptr_t functionEnd = (uintptr_t)address;
+			if (low < libTable->functionStartCount) {
+				functionEnd = libTable->functionStarts[low];
+			} else if (libTable->libInfo->textSeg) {
+				struct SDMSTSeg64Data textData = SDMSTSegmentData(libTable->libInfo->textSeg, libTable->libInfo->is64bit);
+				functionEnd = (uintptr_t)(textData.vmaddr + textData.vmsize) + libTable->libInfo->vmSlide;
+			}
+			if (start)
+				*start = (void*)libTable->functionStarts[low - 0x1];
+			if (end)
+				*end = (void*)functionEnd;
+			found = true;
+		}
+	}
+	return found;
+}
+
+bool SDMSTLibraryUUID(struct SDMMOLibrarySymbolTable *libTable, uint8_t *uuid) {
+	struct SDMSTLoadCommandEntry *entry = (libTable && libTable->libInfo && uuid ? SDMSTCommandFind(libTable->libInfo->commandIndex, LC_UUID) : NULL);
+	if (entry)
+		memcpy(uuid, ((struct uuid_command *)entry->command)->uuid, sizeof(((struct uuid_command *)entry->command)->uuid));
+	return (entry != NULL);
+}
+
+struct SDMSTMachOSymbol* SDMSTSymbolForAddress(struct SDMMOLibrarySymbolTable *libTable, void* address, uint64_t *offsetIntoSymbol) {
+	struct SDMSTMachOSymbol *symbol = NULL;
+	// A call or load through a stub or symbol pointer slot names the import it resolves to rather than whatever symbol
+	// precedes the slot.
+	struct SDMSTStubEntry *stub = (libTable && libTable->libInfo && SDMSTAddressInStubSection(libTable, address) && SDMSTLoadStubIndex(libTable) ? SDMSTStubForAddress(libTable, address) : NULL);
+	if (stub) {
+		symbol = &(libTable->stubIndex->symbols[stub - libTable->stubIndex->entries]);
+		if (offsetIntoSymbol)
+			*offsetIntoSymbol = (uint64_t)((uintptr_t)address - stub->address);
+	} else if (SDMSTMaterializeSymbols(libTable) && libTable->addressIndex) {
+		uint32_t next = SDMSTAddressIndexUpperBound(libTable->addressIndex, (uintptr_t)address);
+		if (next && SDMSTAddressIndexCovers(libTable->addressIndex, next - 0x1, (uintptr_t)address)) {
+			symbol = &(libTable->table[next-0x1]);
+			if (offsetIntoSymbol)
+				*offsetIntoSymbol = (uint64_t)((uintptr_t)address - (uintptr_t)symbol->offset);
+		}
+	}
+	return symbol;
 }
 
 SDMSTParsedLine* SDMSTParse(char *code) {
@@ -261,8 +923,8 @@ uint32_t SDMSTFindInputRegisters(SDMDisasm disasm, char *code) {
 
 uint32_t SDMSTGetArgumentCount(struct SDMMOLibrarySymbolTable *libTable, void* functionPointer) {
 	uint32_t argumentCount = 0x0;
-	if (functionPointer) {
-		uint32_t functionLength = SDMSTGetFunctionLength(libTable, functionPointer);
+	uint32_t functionLength = (functionPointer ? SDMSTGetFunctionLength(libTable, functionPointer) : 0x0);
+	if (functionPointer && SDMSTMapLibraryRange(libTable, functionPointer, functionLength, false)) {
 			struct SDMDisasm disasm = SDM_disasm_init((struct mach_header *)(libTable->libInfo->mhOffset));
 			SDM_disasm_setbuffer(&disasm, functionPointer, functionLength);
 			ud_t obj;
@@ -297,10 +959,57 @@ uint32_t SDMSTGetArgumentCount(struct SDMMOLibrarySymbolTable *libTable, void* f
 	return argumentCount;
 }
 
+bool SDMSTBuildNameIndex(struct SDMMOLibrarySymbolTable *libTable, uint32_t threadCount) {
+	if (libTable->nameIndex == NULL && SDMSTMaterializeSymbols(libTable)) {
+		char **names = (char **)calloc(libTable->symbolCount + 0x1, sizeof(char *));
+		for (uint32_t i = 0x0; i < libTable->symbolCount; i++)
+			names[i] = libTable->table[i].name;
+		libTable->nameIndex = SDMSTPerfectHashCreate(names, libTable->symbolCount, threadCount);
+		free(names);
+	}
+	return (libTable->nameIndex != NULL);
+}
+
+void* SDMSTNameIndexLookup(struct SDMMOLibrarySymbolTable *libTable, char *symbolName) {
+	void* symbolAddress = 0x0;
+	uint64_t length = SDMSTStringLength(symbolName);
+	uint32_t index = SDMSTPerfectHashLookup(libTable->nameIndex, symbolName, length);
+	if (index < libTable->symbolCount && libTable->table[index].nameLength == length && SDMSTStringEqual(libTable->table[index].name, symbolName, length)) {
+		symbolAddress = libTable->table[index].offset;
+	} else {
+		char *prefixedName = (char *)calloc(length + 0x2, sizeof(char));
+		prefixedName[0x0] = '_';
+		memcpy(&prefixedName[0x1], symbolName, length);
+		index = SDMSTPerfectHashLookup(libTable->nameIndex, prefixedName, length + 0x1);
+		if (index < libTable->symbolCount && libTable->table[index].nameLength == length + 0x1 && SDMSTStringEqual(libTable->table[index].name, prefixedName, length + 0x1))
+			symbolAddress = libTable->table[index].offset;
+		free(prefixedName);
+	}
+	return symbolAddress;
+}
+
 SDMSTFunctionCall SDMSTSymbolLookup(struct SDMMOLibrarySymbolTable *libTable, char *symbolName) {
 	void* symbolAddress = 0x0;
-	for (uint32_t i = 0x0; i < libTable->symbolCount; i++)
-		if (SMDSTSymbolDemangleAndCompare(libTable->table[i].name, symbolName)) {
+	// Exported names are answered from the export trie in O(name length); nlist is only searched for private symbols
+	// and for re-exports, whose address lives in another image. A lazily loaded library scans its symtabs without
+	// building the whole table, and finds the same symbol the built table would.
+	struct SDMSTExport exported;
+	if (SDMSTExportLookup(libTable, symbolName, &exported)) {
+		symbolAddress = SDMSTExportAddress(libTable, &exported);
+		if (symbolAddress)
+			return symbolAddress;
+	}
+	if (libTable->nameIndex && symbolName) {
+		symbolAddress = SDMSTNameIndexLookup(libTable, symbolName);
+		if (symbolAddress)
+			return symbolAddress;
+	}
+	uint64_t length = (symbolName ? SDMSTStringLength(symbolName) : 0x0);
+	if (symbolName && libTable->symbolSources && !__atomic_load_n(&(libTable->symbolSources->ready), __ATOMIC_ACQUIRE) && !SDMSTSyntheticNameSuffix(symbolName, length))
+		return SDMSTSymbolSourcesLookup(libTable, symbolName, length);
+	SDMSTMaterializeSymbols(libTable);
+	for (uint32_t i = 0x0; i < libTable->symbolCount && symbolName; i++)
+		if (SDMSTStringHasSuffix(libTable->table[i].name, libTable->table[i].nameLength, symbolName, length)) {
 			symbolAddress = libTable->table[i].offset;
 			break;
 		}
@@ -333,7 +1042,11 @@ struct SDMSTFunctionReturn* SDMSTCallFunction(struct SDMMOLibrarySymbolTable *li
 	struct SDMSTFunctionReturn *result = (struct SDMSTFunctionReturn*)calloc(0x1, sizeof(struct SDMSTFunctionReturn));
 	result->function = function;
 	result->value = (void*)0xdeadbeef;
+#ifdef __APPLE__
 	result->value = makeDynamicCallWithIntList(function->argc, function->args, function->offset);
+#else
+	result->value = NULL;
+#endif
 	//result->value = function->offset(function->args);
 	return result;
 }
@@ -348,16 +1061,47 @@ void SDMSTFunctionReturnRelease(struct SDMSTFunctionReturn *functionReturn) {
 }
 
 void SDMSTLibraryRelease(struct SDMMOLibrarySymbolTable *libTable) {
+	SDMSTPerfectHashRelease(libTable->nameIndex);
+	SDMSTAddressIndexRelease(libTable->addressIndex);
+	if (libTable->libInfo) {
+		free(libTable->libInfo->symtabCommands);
+		SDMSTCommandIndexRelease(libTable->libInfo->commandIndex);
+	}
 	free(libTable->libInfo);
-	for (uint32_t i = 0; i < libTable->symbolCount; i++) {
+	for (uint32_t i = 0; i < libTable->symbolCount && libTable->cacheBase == NULL; i++) {
 		if (libTable->table[i].isStub)
 			free(libTable->table[i].name);
 	}
+	if (libTable->symbolSources) {
+		for (uint32_t i = 0x0; i < libTable->symbolSources->count; i++) {
+			free(libTable->symbolSources->sources[i].symbols);
+			free(libTable->symbolSources->sources[i].names);
+		}
+		pthread_mutex_destroy(&(libTable->symbolSources->lock));
+		free(libTable->symbolSources->sources);
+		free(libTable->symbolSources);
+	}
+	if (libTable->cacheBase)
+		munmap(libTable->cacheBase, libTable->cacheSize);
 	free(libTable->table);
+	free(libTable->functionStarts);
+	SDMSTStubIndexRelease(libTable->stubIndex);
+#ifdef __APPLE__
 	if (libTable->couldLoad)
 		dlclose(libTable->libraryHandle);
-	else
-		munmap(libTable->libraryHandle, libTable->librarySize);
+#endif
+	// A shared mapping belongs to whoever handed it to SDMSTLoadMappedImage.
+	if (!libTable->sharedMapping) {
+		if (libTable->mapping && libTable->mapping->streamWindow)
+			free(libTable->mappingBase);
+		else if (!libTable->couldLoad && libTable->mappingBase)
+			munmap(libTable->mappingBase, libTable->librarySize);
+		if (libTable->mapping) {
+			close(libTable->mapping->fd);
+			free(libTable->mapping->pages);
+			free(libTable->mapping);
+		}
+	}
 	free(libTable);
 }
 
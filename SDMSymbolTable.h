@@ -27,9 +27,22 @@
 #include <stdlib.h>
 #include <stdarg.h>
 
-#include <mach-o/loader.h>
+#include "SDMMachOTypes.h"
+#include "SDMSTPerfectHash.h"
+#include "SDMSTAddressIndex.h"
 
 
+#pragma mark -
+#pragma mark Constants
+
+#define kSDMSTLoadOK 0x0
+#define kSDMSTLoadOpenFailed 0x1
+#define kSDMSTLoadNotMachO 0x2
+#define kSDMSTLoadNoSlice 0x3
+#define kSDMSTLoadMapFailed 0x4
+
+#define kSDMSTSyntheticTable 0xffffffff
+
 #pragma mark -
 #pragma mark Types
 
@@ -42,7 +55,7 @@ typedef struct SDMSTFunction {
 	uintptr_t *args;
 } __attribute__ ((packed)) SDMSTFunction;
 
-struct SDMSTFunctionReturn {
+typedef struct SDMSTFunctionReturn {
 	struct SDMSTFunction *function;
 	void* value;
 } __attribute__ ((packed)) SDMSTFunctionReturn;
@@ -58,9 +71,27 @@ typedef struct SDMSTLibraryArchitecture {
 	cpu_subtype_t subtype;
 } __attribute__ ((packed)) SDMSTLibraryArchitecture;
 
+typedef struct SDMSTLoadOptions {
+	struct SDMSTLibraryArchitecture arch;
+	uint32_t streamWindow;
+	uint32_t threadCount;
+	char *cacheDirectory;
+	bool lazySymbols;
+	bool fileOnly;
+} __attribute__ ((packed)) SDMSTLoadOptions;
+
+typedef struct SDMSTLibraryMapping {
+	int fd;
+	uint64_t fileOffset;
+	uint64_t pageSize;
+	uint8_t *pages;
+	uint32_t streamWindow;
+} __attribute__ ((packed)) SDMSTLibraryMapping;
+
 typedef struct SDMSTLibraryTableInfo {
 	uint32_t imageNumber;
 	uintptr_t *mhOffset;
+	struct SDMSTCommandIndex *commandIndex;
 	struct SDMSTSegmentEntry *textSeg;
 	struct SDMSTSegmentEntry *linkSeg;
 	struct symtab_command *symtabCommands;
@@ -68,6 +99,15 @@ typedef struct SDMSTLibraryTableInfo {
 	uint32_t headerMagic;
 	bool is64bit;
 	struct SDMSTLibraryArchitecture arch;
+	intptr_t vmSlide;
+	char *linkeditBase;
+	char *localSymbolsBase;
+	uint32_t exportOffset;
+	uint32_t exportSize;
+	uint32_t functionStartsOffset;
+	uint32_t functionStartsSize;
+	uint32_t indirectSymbolOffset;
+	uint32_t indirectSymbolCount;
 } __attribute__ ((packed)) SDMSTLibraryTableInfo;
 
 typedef struct SDMSTMachOSymbol {
@@ -76,22 +116,49 @@ typedef struct SDMSTMachOSymbol {
 	void* offset;
 	char *name;
 	bool isStub;
+	uint32_t nameLength;
 } __attribute__ ((packed)) SDMSTMachOSymbol;
 
 typedef struct SDMMOLibrarySymbolTable {
 	bool couldLoad;
+	uint32_t loadStatus;
 	char *libraryPath;
 	uintptr_t* libraryHandle;
 	uint64_t librarySize;
+	void* mappingBase;
+	struct SDMSTLibraryMapping *mapping;
+	bool sharedMapping;
+	bool byteSwapped;
 	struct SDMSTLibraryTableInfo *libInfo;
 	struct SDMSTMachOSymbol *table;
 	uint32_t symbolCount;
+	struct SDMSTSymbolSources *symbolSources;
+	struct SDMSTPerfectHash *nameIndex;
+	struct SDMSTAddressIndex *addressIndex;
+	uintptr_t *functionStarts;
+	uint32_t functionStartCount;
+	struct SDMSTStubIndex *stubIndex;
+	void *cacheBase;
+	uint64_t cacheSize;
 } __attribute__ ((packed)) SDMMOLibrarySymbolTable;
 
 #pragma mark -
 #pragma mark Declarations
 
 struct SDMMOLibrarySymbolTable* SDMSTLoadLibrary(char *path);
+struct SDMMOLibrarySymbolTable* SDMSTLoadLibraryWithOptions(char *path, struct SDMSTLoadOptions *options);
+struct SDMMOLibrarySymbolTable* SDMSTLoadMappedImage(char *path, void* header, void* linkeditBase, void* fileBase, uint64_t fileSize, struct SDMSTLibraryMapping *mapping, struct symtab_command *localSymbols, void* localSymbolsBase);
+bool SDMSTMaterializeSymbols(struct SDMMOLibrarySymbolTable *libTable);
+struct SDMSTStubIndex* SDMSTLoadStubIndex(struct SDMMOLibrarySymbolTable *libTable);
+bool SDMSTBuildNameIndex(struct SDMMOLibrarySymbolTable *libTable, uint32_t threadCount);
+struct SDMSTMachOSymbol* SDMSTSymbolForAddress(struct SDMMOLibrarySymbolTable *libTable, void* address, uint64_t *offsetIntoSymbol);
+uint64_t SDMSTBuildPageIndex(struct SDMMOLibrarySymbolTable *libTable);
+uint64_t SDMSTAddressIndexMemory(struct SDMMOLibrarySymbolTable *libTable, uint64_t *pageIndexMemory);
+bool SDMSTMapLibraryRange(struct SDMMOLibrarySymbolTable *libTable, void* address, uint64_t length, bool sequential);
+const uint8_t* SDMSTLinkeditData(struct SDMMOLibrarySymbolTable *libTable, uint32_t offset, uint32_t size, bool *owned);
+bool SDMSTFunctionBounds(struct SDMMOLibrarySymbolTable *libTable, void* address, void** start, void** end);
+bool SDMSTLibraryUUID(struct SDMMOLibrarySymbolTable *libTable, uint8_t *uuid);
+SDMSTFunctionCall SDMSTSymbolLookup(struct SDMMOLibrarySymbolTable *libTable, char *symbolName);
 struct SDMSTFunction* SDMSTCreateFunction(struct SDMMOLibrarySymbolTable *libTable, char *name);
 struct SDMSTFunctionReturn* SDMSTCallFunction(struct SDMMOLibrarySymbolTable *libTable, struct SDMSTFunction *function);
 void SDMSTFunctionRelease(struct SDMSTFunction *function);
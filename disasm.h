@@ -20,7 +20,7 @@
 #define _SDMDISASM_H_
 
 #include <stdbool.h>
-#include <mach-o/loader.h>
+#include "SDMMachOTypes.h"
 #include "udis86.h"
 #include "arm_decode.h"
 